@@ -0,0 +1,81 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/Model.hpp>
+#include <libslic3r/Print.hpp>
+#include <libslic3r/GCode.hpp>
+#include <libslic3r/GCode/PreviewData.hpp>
+#include <libnest2d/tools/benchmark.h>
+
+const std::string USAGE_STR = {
+    "Usage: gcodebench [--preview] [stlfilename.stl]\n"
+    "Measures the G-code export throughput in MB/s. Without an input file, a finely tesselated sphere is printed.\n"
+    "With --preview, the G-code is processed by the G-code analyzer as well, as if exported from the UI."
+};
+
+int main(const int argc, const char *argv[]) {
+    using namespace Slic3r;
+    using std::cout; using std::endl;
+
+    bool        preview = false;
+    std::string input_file;
+    for (int i = 1; i < argc; ++ i) {
+        std::string arg(argv[i]);
+        if (arg == "-h" || arg == "--help") {
+            cout << USAGE_STR << endl;
+            return EXIT_SUCCESS;
+        } else if (arg == "--preview")
+            preview = true;
+        else
+            input_file = arg;
+    }
+
+    TriangleMesh mesh;
+    if (! input_file.empty()) {
+        mesh.ReadSTLFile(input_file.c_str());
+        mesh.repair();
+    } else
+        mesh = make_sphere(30., 2. * PI / 720.);
+
+    Model model;
+    ModelObject *object = model.add_object();
+    object->add_volume(mesh);
+    object->add_instance();
+    model.center_instances_around_point(Vec2d(100., 100.));
+
+    DynamicPrintConfig config;
+    config.apply(FullPrintConfig::defaults());
+    config.normalize();
+
+    Print print;
+    print.apply(model, config);
+    std::string err = print.validate();
+    if (! err.empty()) {
+        std::cerr << err << endl;
+        return EXIT_FAILURE;
+    }
+
+    Benchmark bench;
+    bench.start();
+    print.process();
+    bench.stop();
+    cout << "Facets: " << mesh.facets_count() << ", processing time: " << std::setprecision(4) << bench.getElapsedSec() << " seconds." << endl;
+
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("gcodebench-%%%%-%%%%.gcode");
+    GCode            gcode;
+    GCodePreviewData preview_data;
+    bench.start();
+    gcode.do_export(&print, path.string().c_str(), preview ? &preview_data : nullptr);
+    bench.stop();
+
+    double size_MB = double(boost::filesystem::file_size(path)) / (1024. * 1024.);
+    boost::filesystem::remove(path);
+    cout << "G-code export: " << std::setprecision(4) << size_MB << " MB in " << bench.getElapsedSec() << " seconds, "
+         << size_MB / bench.getElapsedSec() << " MB/s" << (preview ? " (with the G-code analyzer)." : ".") << endl;
+
+    return EXIT_SUCCESS;
+}
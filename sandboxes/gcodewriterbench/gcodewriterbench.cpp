@@ -0,0 +1,101 @@
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/GCodeWriter.hpp>
+#include <libnest2d/tools/benchmark.h>
+
+const std::string USAGE_STR = {
+    "Usage: gcodewriterbench [number_of_lines]\n"
+    "Measures the cost of a single extrusion and travel G-code line produced by the GCodeWriter\n"
+    "and compares the output with the reference std::ostringstream formatting."
+};
+
+// The std::ostringstream based formatting of the G1 lines, as the GCodeWriter used to do it.
+#define PRECISION(val, precision) std::fixed << std::setprecision(precision) << val
+#define XYZF_NUM(val) PRECISION(val, 3)
+#define E_NUM(val) PRECISION(val, 5)
+
+static std::string reference_extrude_to_xy(const Slic3r::Vec2d &point, double E)
+{
+    std::ostringstream gcode;
+    gcode << "G1 X" << XYZF_NUM(point(0)) << " Y" << XYZF_NUM(point(1)) << " E" << E_NUM(E) << "\n";
+    return gcode.str();
+}
+
+static std::string reference_travel_to_xy(const Slic3r::Vec2d &point, double F)
+{
+    std::ostringstream gcode;
+    gcode << "G1 X" << XYZF_NUM(point(0)) << " Y" << XYZF_NUM(point(1)) << " F" << XYZF_NUM(F) << "\n";
+    return gcode.str();
+}
+
+int main(const int argc, const char *argv[]) {
+    using namespace Slic3r;
+    using std::cout; using std::endl;
+
+    size_t num_lines = 1000000;
+    if (argc > 1) {
+        std::string arg(argv[1]);
+        if (arg == "-h" || arg == "--help") {
+            cout << USAGE_STR << endl;
+            return EXIT_SUCCESS;
+        }
+        num_lines = std::stoul(arg);
+    }
+
+    // Random points on a 250x210mm bed and random extrusion increments, including values close to the rounding ties.
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<double> random_x(0., 250.), random_y(0., 210.), random_e(0., 0.1);
+    std::vector<Vec2d>  points(num_lines);
+    std::vector<double> dEs(num_lines);
+    for (size_t i = 0; i < num_lines; ++ i) {
+        points[i] = Vec2d(random_x(rng), random_y(rng));
+        if (i % 16 == 0)
+            points[i] = Vec2d(std::floor(points[i](0)) + 0.0005, std::floor(points[i](1)) + 0.0125);
+        dEs[i] = random_e(rng);
+    }
+
+    PrintConfig config;
+    GCodeWriter writer;
+    writer.apply_print_config(config);
+    writer.set_extruders({ 0 });
+    writer.set_extruder(0);
+    double F = config.travel_speed.value * 60.;
+
+    Benchmark bench;
+    std::string gcode;
+    gcode.reserve(num_lines * 64);
+    bench.start();
+    for (size_t i = 0; i < num_lines; ++ i) {
+        writer.extrude_to_xy(gcode, points[i], dEs[i]);
+        writer.travel_to_xy(gcode, points[i]);
+    }
+    bench.stop();
+    double time_writer = bench.getElapsedSec();
+
+    // Reference formatting with the extrusion values accumulated the same way as by the Extruder.
+    std::string reference;
+    reference.reserve(num_lines * 64);
+    double E = 0.;
+    bench.start();
+    for (size_t i = 0; i < num_lines; ++ i) {
+        E += dEs[i];
+        reference += reference_extrude_to_xy(points[i], E);
+        reference += reference_travel_to_xy(points[i], F);
+    }
+    bench.stop();
+    double time_reference = bench.getElapsedSec();
+
+    cout << "GCodeWriter: " << std::setprecision(4) << time_writer * 1e9 / double(2 * num_lines) << " ns per line, "
+         << "std::ostringstream: " << time_reference * 1e9 / double(2 * num_lines) << " ns per line." << endl;
+    if (gcode != reference) {
+        std::cerr << "The GCodeWriter output differs from the reference output!" << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
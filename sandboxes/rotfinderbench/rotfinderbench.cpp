@@ -0,0 +1,96 @@
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/Model.hpp>
+#include <libslic3r/SLA/SLARotfinder.hpp>
+#include <libslic3r/SLA/SLASupportTree.hpp>
+#include <libnest2d/tools/benchmark.h>
+
+const std::string USAGE_STR = {
+    "Usage: rotfinderbench [number_of_evaluations] [stlfilename.stl]\n"
+    "Measures the objective function evaluations per second of the SLA orientation search and compares it with\n"
+    "the reference per-face scalar evaluation. Without an input file, a finely tesselated sphere is examined."
+};
+
+// The objective function as find_best_rotation() used to evaluate it, calculating the face normals on each evaluation.
+static double reference_score(const Slic3r::sla::EigenMesh3D &m, double rx, double ry, double rz)
+{
+    using namespace Slic3r;
+    Transform3d rt = Transform3d::Identity();
+    rt.rotate(Eigen::AngleAxisd(rz, Vec3d::UnitZ()));
+    rt.rotate(Eigen::AngleAxisd(ry, Vec3d::UnitY()));
+    rt.rotate(Eigen::AngleAxisd(rx, Vec3d::UnitX()));
+
+    double score = 0;
+    for (int i = 0; i < m.F().rows(); ++ i) {
+        auto  idx = m.F().row(i);
+        Vec3d p1  = m.V().row(idx(0));
+        Vec3d p2  = m.V().row(idx(1));
+        Vec3d p3  = m.V().row(idx(2));
+        Vec3d n   = rt * Vec3d((p2 - p1).cross(p3 - p1).normalized());
+        score += std::abs(n.dot(Vec3d::UnitX())) + std::abs(n.dot(Vec3d::UnitY())) + std::abs(n.dot(Vec3d::UnitZ()));
+    }
+    return score;
+}
+
+int main(const int argc, const char *argv[]) {
+    using namespace Slic3r;
+    using std::cout; using std::endl;
+
+    unsigned    num_evals = 200;
+    std::string input_file;
+    if (argc > 1) {
+        std::string arg(argv[1]);
+        if (arg == "-h" || arg == "--help") {
+            cout << USAGE_STR << endl;
+            return EXIT_SUCCESS;
+        }
+        num_evals = unsigned(std::stoul(arg));
+    }
+    if (argc > 2)
+        input_file = argv[2];
+
+    TriangleMesh mesh;
+    if (! input_file.empty()) {
+        mesh.ReadSTLFile(input_file.c_str());
+        mesh.repair();
+    } else
+        mesh = make_sphere(30., 2. * PI / 720.);
+
+    Model model;
+    ModelObject *object = model.add_object();
+    object->add_volume(mesh);
+    object->add_instance();
+
+    // The orientation search, counting the evaluations through the stop condition, which is queried once per evaluation.
+    Benchmark bench;
+    unsigned  evals = 0;
+    bench.start();
+    std::array<double, 3> rot = sla::find_best_rotation(*object, float(num_evals) / 100000.f,
+                                                        [](unsigned) {}, [&evals]() { ++ evals; return false; });
+    bench.stop();
+    double time_search = bench.getElapsedSec();
+
+    // The reference evaluation of random rotations.
+    sla::EigenMesh3D emesh(object->raw_mesh());
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<double> random_angle(-PI / 2., PI / 2.);
+    unsigned num_reference = std::max(1u, std::min(num_evals, 20u));
+    double   sum = 0.;
+    bench.start();
+    for (unsigned i = 0; i < num_reference; ++ i)
+        sum += reference_score(emesh, random_angle(rng), random_angle(rng), random_angle(rng));
+    bench.stop();
+    double time_reference = bench.getElapsedSec();
+
+    cout << "Facets: " << mesh.facets_count() << ", rotation found: " << rot[0] << ", " << rot[1] << ", " << rot[2] << endl
+         << "find_best_rotation: " << evals << " evaluations in " << std::setprecision(4) << time_search << " seconds, "
+         << double(evals) / time_search << " evaluations per second." << endl
+         << "Reference: " << num_reference << " evaluations in " << time_reference << " seconds, "
+         << double(num_reference) / time_reference << " evaluations per second (checksum " << sum << ")." << endl;
+
+    return EXIT_SUCCESS;
+}
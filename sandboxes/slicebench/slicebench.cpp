@@ -0,0 +1,64 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include <tbb/task_scheduler_init.h>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/TriangleMesh.hpp>
+#include <libnest2d/tools/benchmark.h>
+
+const std::string USAGE_STR = {
+    "Usage: slicebench [stlfilename.stl] [layer_height]\n"
+    "Without an input file, a finely tesselated sphere is sliced."
+};
+
+int main(const int argc, const char *argv[]) {
+    using namespace Slic3r;
+    using std::cout; using std::endl;
+
+    if (argc > 1 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")) {
+        cout << USAGE_STR << endl;
+        return EXIT_SUCCESS;
+    }
+
+    TriangleMesh mesh;
+    if (argc > 1) {
+        mesh.ReadSTLFile(argv[1]);
+        mesh.repair();
+    } else
+        // Roughly 2.6M facets.
+        mesh = make_sphere(50., 2. * PI / 1150.);
+    mesh.align_to_origin();
+
+    const float layer_height = (argc > 2) ? float(atof(argv[2])) : 0.05f;
+    BoundingBoxf3 bb = mesh.bounding_box();
+    std::vector<float> z;
+    for (float zz = float(bb.min(2)) + 0.5f * layer_height; zz < bb.max(2); zz += layer_height)
+        z.emplace_back(zz);
+
+    cout << "Facets: " << mesh.facets_count() << ", layers: " << z.size() << endl;
+
+    Benchmark bench;
+    TriangleMeshSlicer slicer;
+    bench.start();
+    slicer.init(&mesh, [](){});
+    bench.stop();
+    cout << "Slicer initialization: " << std::setprecision(4) << bench.getElapsedSec() << " seconds." << endl;
+
+    for (int threads : { 1, 2, 4, 8, 16 }) {
+        tbb::task_scheduler_init scheduler(threads);
+        std::vector<ExPolygons> layers;
+        bench.start();
+        slicer.slice(z, &layers, [](){});
+        bench.stop();
+        size_t num_expolygons = 0;
+        for (const ExPolygons &layer : layers)
+            num_expolygons += layer.size();
+        cout << "Threads: " << std::setw(2) << threads << ", slicing time: " << std::setprecision(4) << bench.getElapsedSec()
+             << " seconds, " << num_expolygons << " ExPolygons." << endl;
+    }
+
+    return EXIT_SUCCESS;
+}
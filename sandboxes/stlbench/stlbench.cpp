@@ -0,0 +1,113 @@
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/cstdio.hpp>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/TriangleMesh.hpp>
+#include <libnest2d/tools/benchmark.h>
+
+const std::string USAGE_STR = {
+    "Usage: stlbench [stlfilename.stl]\n"
+    "Without an input file, a finely tesselated sphere is written both as a binary and an ASCII STL and loaded back."
+};
+
+// Reference loader reading one facet per fread() / fscanf() call, as stl_read() used to do.
+static bool legacy_read(const std::string &path, std::vector<stl_facet> &facets)
+{
+    facets.clear();
+    FILE *fp = boost::nowide::fopen(path.c_str(), "rb");
+    if (fp == nullptr)
+        return false;
+    fseek(fp, 0, SEEK_END);
+    long file_size = ftell(fp);
+    rewind(fp);
+    // Same heuristic as stl_count_facets(): a binary file has a valid facet count in its header.
+    uint32_t header_num_facets = 0;
+    fseek(fp, LABEL_SIZE, SEEK_SET);
+    bool binary = fread(&header_num_facets, sizeof(uint32_t), 1, fp) == 1 &&
+        long(HEADER_SIZE) + long(header_num_facets) * SIZEOF_STL_FACET == file_size;
+    stl_facet facet;
+    if (binary) {
+        facets.reserve(header_num_facets);
+        fseek(fp, HEADER_SIZE, SEEK_SET);
+        for (uint32_t i = 0; i < header_num_facets; ++ i) {
+            if (fread(&facet, 1, SIZEOF_STL_FACET, fp) != SIZEOF_STL_FACET)
+                break;
+            facets.emplace_back(facet);
+        }
+    } else {
+        rewind(fp);
+        for (;;) {
+            fscanf(fp, "endsolid%*[^\n]\n");
+            fscanf(fp, "solid%*[^\n]\n");
+            if (fscanf(fp, " facet normal %f %f %f", &facet.normal(0), &facet.normal(1), &facet.normal(2)) != 3 ||
+                fscanf(fp, " outer loop") != 0)
+                break;
+            for (int j = 0; j < 3; ++ j)
+                fscanf(fp, " vertex %f %f %f", &facet.vertex[j](0), &facet.vertex[j](1), &facet.vertex[j](2));
+            fscanf(fp, " endloop");
+            fscanf(fp, " endfacet%*[^\n]\n");
+            facets.emplace_back(facet);
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+static void bench_file(const std::string &path)
+{
+    using std::cout; using std::endl;
+    Benchmark bench;
+
+    std::vector<stl_facet> facets;
+    bench.start();
+    legacy_read(path, facets);
+    bench.stop();
+    double t_legacy = bench.getElapsedSec();
+
+    Slic3r::TriangleMesh mesh;
+    bench.start();
+    mesh.ReadSTLFile(path.c_str());
+    bench.stop();
+    double t_current = bench.getElapsedSec();
+
+    cout << path << ": " << (mesh.stl.stats.type == binary ? "binary" : "ASCII") << ", "
+         << mesh.facets_count() << " facets (reference loader: " << facets.size() << ")" << endl
+         << "    reference loader: " << std::setprecision(4) << t_legacy  << " seconds" << endl
+         << "    stl_open:         " << std::setprecision(4) << t_current << " seconds" << endl;
+}
+
+int main(const int argc, const char *argv[]) {
+    using namespace Slic3r;
+    using std::cout; using std::endl;
+
+    if (argc > 1 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")) {
+        cout << USAGE_STR << endl;
+        return EXIT_SUCCESS;
+    }
+
+    if (argc > 1) {
+        bench_file(argv[1]);
+        return EXIT_SUCCESS;
+    }
+
+    // Roughly 1.3M facets.
+    TriangleMesh mesh = make_sphere(50., 2. * PI / 800.);
+    boost::filesystem::path tmp = boost::filesystem::temp_directory_path();
+    std::string path_binary = (tmp / boost::filesystem::unique_path("stlbench-%%%%-%%%%.stl")).string();
+    std::string path_ascii  = (tmp / boost::filesystem::unique_path("stlbench-%%%%-%%%%.stl")).string();
+    mesh.write_binary(path_binary.c_str());
+    mesh.write_ascii(path_ascii.c_str());
+
+    bench_file(path_binary);
+    bench_file(path_ascii);
+
+    boost::filesystem::remove(path_binary);
+    boost::filesystem::remove(path_ascii);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+#include <tbb/task_scheduler_init.h>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/Model.hpp>
+#include <libslic3r/Print.hpp>
+#include <libslic3r/SupportMaterial.hpp>
+#include <libnest2d/tools/benchmark.h>
+
+const std::string USAGE_STR = {
+    "Usage: supportbench [stlfilename.stl]\n"
+    "Measures the support generation time with a varying number of threads.\n"
+    "Without an input file, a tall column carrying a stack of staggered overhanging slabs topped by a sphere is printed."
+};
+
+int main(const int argc, const char *argv[]) {
+    using namespace Slic3r;
+    using std::cout; using std::endl;
+
+    if (argc > 1 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")) {
+        cout << USAGE_STR << endl;
+        return EXIT_SUCCESS;
+    }
+
+    Model model;
+    ModelObject *object = model.add_object();
+    if (argc > 1) {
+        TriangleMesh mesh;
+        mesh.ReadSTLFile(argv[1]);
+        mesh.repair();
+        object->add_volume(mesh);
+    } else {
+        const double height = 150.;
+        TriangleMesh column = make_cylinder(5., height, 2. * PI / 90.);
+        column.translate(30.f, 30.f, 0.f);
+        object->add_volume(column);
+        // Each slab overhangs both the column and the slab below, so the support lands both on the bed and on the object.
+        for (int i = 0; i < 13; ++ i) {
+            TriangleMesh slab = make_cube(40., 40., 1.5);
+            slab.translate((i & 1) ? 0.f : 20.f, (i % 3) * 10.f, float(10. + 10. * i));
+            object->add_volume(slab);
+        }
+        TriangleMesh sphere = make_sphere(20., 2. * PI / 180.);
+        sphere.translate(30.f, 30.f, float(height + 15.));
+        object->add_volume(sphere);
+    }
+    object->add_instance();
+    model.center_instances_around_point(Vec2d(100., 100.));
+
+    DynamicPrintConfig config;
+    config.apply(FullPrintConfig::defaults());
+    config.set_key_value("support_material", new ConfigOptionBool(true));
+    config.normalize();
+
+    Print print;
+    print.apply(model, config);
+    std::string err = print.validate();
+    if (! err.empty()) {
+        std::cerr << err << endl;
+        return EXIT_FAILURE;
+    }
+
+    Benchmark bench;
+    bench.start();
+    print.process();
+    bench.stop();
+    PrintObject *print_object = print.get_object(0);
+    cout << "Layers: " << print_object->layer_count() << ", support layers: " << print_object->support_layer_count() 
+         << ", processing time: " << std::setprecision(4) << bench.getElapsedSec() << " seconds." << endl;
+
+    for (int threads : { 1, 2, 4, 8, 16 }) {
+        tbb::task_scheduler_init scheduler(threads);
+        print_object->clear_support_layers();
+        bench.start();
+        PrintObjectSupportMaterial support_material(print_object, print_object->slicing_parameters());
+        support_material.generate(*print_object);
+        bench.stop();
+        cout << "Threads: " << std::setw(2) << threads << ", support generation time: " << std::setprecision(4) << bench.getElapsedSec()
+             << " seconds, " << print_object->support_layer_count() << " support layers." << endl;
+    }
+
+    return EXIT_SUCCESS;
+}
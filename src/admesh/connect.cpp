@@ -30,6 +30,10 @@
 
 #include <boost/detail/endian.hpp>
 
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+#include <tbb/parallel_sort.h>
+
 #include "stl.h"
 
 
@@ -37,10 +41,13 @@ static void stl_match_neighbors_nearby(stl_file *stl,
                                        stl_hash_edge *edge_a, stl_hash_edge *edge_b);
 static void stl_record_neighbors(stl_file *stl,
                                  stl_hash_edge *edge_a, stl_hash_edge *edge_b);
+static void stl_connect_edges(stl_file *stl,
+                              const stl_hash_edge *edge_a, const stl_hash_edge *edge_b);
 static void stl_initialize_facet_check_exact(stl_file *stl);
 static void stl_initialize_facet_check_nearby(stl_file *stl);
 static void stl_load_edge_exact(stl_file *stl, stl_hash_edge *edge,
                                 stl_vertex *a, stl_vertex *b);
+static void stl_load_edge_key_exact(stl_hash_edge *edge, const stl_vertex *a, const stl_vertex *b);
 static int stl_load_edge_nearby(stl_file *stl, stl_hash_edge *edge,
                                 stl_vertex *a, stl_vertex *b, float tolerance);
 static void insert_hash_edge(stl_file *stl, stl_hash_edge edge,
@@ -68,11 +75,6 @@ stl_check_facets_exact(stl_file *stl) {
    *  floats of the first edge matches all six floats of the second edge.
    */
 
-  stl_hash_edge  edge;
-  stl_facet      facet;
-  int            i;
-  int            j;
-
   if (stl->error) return;
 
   stl->stats.connected_edges = 0;
@@ -82,25 +84,89 @@ stl_check_facets_exact(stl_file *stl) {
 
   stl_initialize_facet_check_exact(stl);
 
-  for(i = 0; i < stl->stats.number_of_facets; i++) {
-    facet = stl->facet_start[i];
-    // If any two of the three vertices are found to be exactally the same, call them degenerate and remove the facet.
+  // If any two of the three vertices are found to be exactally the same, call them degenerate and remove the facet.
+  // The last facet is moved into the place of the removed one, therefore the facets are removed before
+  // the edges are collected to produce the same facet order as if they were removed while collecting the edges.
+  for (int i = 0; i < stl->stats.number_of_facets; ++ i) {
+    const stl_facet &facet = stl->facet_start[i];
     if (facet.vertex[0] == facet.vertex[1] ||
         facet.vertex[1] == facet.vertex[2] ||
         facet.vertex[0] == facet.vertex[2]) {
       stl->stats.degenerate_facets += 1;
       stl_remove_facet(stl, i);
       -- i;
-      continue;
     }
-    for(j = 0; j < 3; j++) {
-      edge.facet_number = i;
-      edge.which_edge = j;
-      stl_load_edge_exact(stl, &edge, &facet.vertex[j], &facet.vertex[(j + 1) % 3]);
-      insert_hash_edge(stl, edge, stl_record_neighbors);
+  }
+
+  // Collect the edges of all facets.
+  const size_t num_edges = size_t(stl->stats.number_of_facets) * 3;
+  std::vector<stl_hash_edge> edges(num_edges);
+  stl->stats.shortest_edge = std::min(stl->stats.shortest_edge, tbb::parallel_reduce(
+    tbb::blocked_range<int>(0, stl->stats.number_of_facets), stl->stats.shortest_edge,
+    [stl, &edges](const tbb::blocked_range<int> &range, float shortest_edge) {
+      for (int i = range.begin(); i < range.end(); ++ i) {
+        const stl_facet &facet = stl->facet_start[i];
+        for (int j = 0; j < 3; ++ j) {
+          const stl_vertex  &a    = facet.vertex[j];
+          const stl_vertex  &b    = facet.vertex[(j + 1) % 3];
+          stl_hash_edge     &edge = edges[i * 3 + j];
+          stl_vertex         diff = (a - b).cwiseAbs();
+          shortest_edge = std::min(shortest_edge, std::max(diff(0), std::max(diff(1), diff(2))));
+          edge.facet_number = i;
+          edge.which_edge   = j;
+          stl_load_edge_key_exact(&edge, &a, &b);
+        }
+      }
+      return shortest_edge;
+    },
+    [](float a, float b) { return std::min(a, b); }));
+
+  // Sort the edges by their key, edges with equal keys are kept in the order of their facets.
+  tbb::parallel_sort(edges.begin(), edges.end(), [](const stl_hash_edge &edge_a, const stl_hash_edge &edge_b) {
+    int cmp = memcmp(edge_a.key, edge_b.key, sizeof(edge_a.key));
+    return cmp < 0 || (cmp == 0 && (edge_a.facet_number < edge_b.facet_number ||
+      (edge_a.facet_number == edge_b.facet_number && edge_a.which_edge % 3 < edge_b.which_edge % 3)));
+  });
+
+  // Match the edges sharing a key the same way a hash table of the edges inserted in the order of facets would:
+  // An edge is connected to the first unconnected edge of another facet inserted before it, otherwise it stays unconnected.
+  // Each group of equal keys is processed by the thread owning the start of the group.
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, num_edges), [stl, &edges, num_edges](const tbb::blocked_range<size_t> &range) {
+    std::vector<const stl_hash_edge*> unconnected;
+    size_t i = range.begin();
+    while (i < range.end() && i > 0 && edges[i] == edges[i - 1])
+      ++ i;
+    while (i < range.end()) {
+      size_t j = i + 1;
+      while (j < num_edges && edges[j] == edges[i])
+        ++ j;
+      unconnected.clear();
+      for (; i < j; ++ i) {
+        const stl_hash_edge &edge = edges[i];
+        auto it = std::find_if(unconnected.begin(), unconnected.end(),
+          [&edge](const stl_hash_edge *other) { return other->facet_number != edge.facet_number; });
+        if (it == unconnected.end())
+          unconnected.emplace_back(&edge);
+        else {
+          stl_connect_edges(stl, &edge, *it);
+          unconnected.erase(it);
+        }
+      }
     }
+  });
+
+  // Count the connects, as if the edges were connected one by one by stl_record_neighbors().
+  for (int i = 0; i < stl->stats.number_of_facets; ++ i) {
+    const stl_neighbors &nbr = stl->neighbors_start[i];
+    int num_connected = (nbr.neighbor[0] != -1) + (nbr.neighbor[1] != -1) + (nbr.neighbor[2] != -1);
+    stl->stats.connected_edges += num_connected;
+    if (num_connected > 0)
+      stl->stats.connected_facets_1_edge += 1;
+    if (num_connected > 1)
+      stl->stats.connected_facets_2_edge += 1;
+    if (num_connected > 2)
+      stl->stats.connected_facets_3_edge += 1;
   }
-  stl_free_edges(stl);
 
 #if 0
   printf("Number of faces: %d, number of manifold edges: %d, number of connected edges: %d, number of unconnected edges: %d\r\n", 
@@ -121,6 +187,11 @@ stl_load_edge_exact(stl_file *stl, stl_hash_edge *edge,
     stl->stats.shortest_edge = std::min(max_diff, stl->stats.shortest_edge);
   }
 
+  stl_load_edge_key_exact(edge, a, b);
+}
+
+static void
+stl_load_edge_key_exact(stl_hash_edge *edge, const stl_vertex *a, const stl_vertex *b) {
   // Ensure identical vertex ordering of equal edges.
   // This method is numerically robust.
   if (stl_vertex_lower(*a, *b)) {
@@ -165,26 +236,12 @@ stl_initialize_facet_check_exact(stl_file *stl) {
   stl->stats.freed = 0;
   stl->stats.collisions = 0;
 
-  stl->M = hash_size_from_nr_faces(stl->stats.number_of_facets);
-
   for (i = 0; i < stl->stats.number_of_facets ; i++) {
     /* initialize neighbors list to -1 to mark unconnected edges */
     stl->neighbors_start[i].neighbor[0] = -1;
     stl->neighbors_start[i].neighbor[1] = -1;
     stl->neighbors_start[i].neighbor[2] = -1;
   }
-
-  stl->heads = (stl_hash_edge**)calloc(stl->M, sizeof(*stl->heads));
-  if(stl->heads == NULL) perror("stl_initialize_facet_check_exact");
-
-  stl->tail = (stl_hash_edge*)malloc(sizeof(stl_hash_edge));
-  if(stl->tail == NULL) perror("stl_initialize_facet_check_exact");
-
-  stl->tail->next = stl->tail;
-
-  for(i = 0; i < stl->M; i++) {
-    stl->heads[i] = stl->tail;
-  }
 }
 
 static void insert_hash_edge(stl_file *stl, stl_hash_edge edge,
@@ -375,32 +432,7 @@ stl_record_neighbors(stl_file *stl,
 
   if (stl->error) return;
 
-  /* Facet a's neighbor is facet b */
-  stl->neighbors_start[edge_a->facet_number].neighbor[edge_a->which_edge % 3] =
-    edge_b->facet_number;	/* sets the .neighbor part */
-
-  stl->neighbors_start[edge_a->facet_number].
-  which_vertex_not[edge_a->which_edge % 3] =
-    (edge_b->which_edge + 2) % 3; /* sets the .which_vertex_not part */
-
-  /* Facet b's neighbor is facet a */
-  stl->neighbors_start[edge_b->facet_number].neighbor[edge_b->which_edge % 3] =
-    edge_a->facet_number;	/* sets the .neighbor part */
-
-  stl->neighbors_start[edge_b->facet_number].
-  which_vertex_not[edge_b->which_edge % 3] =
-    (edge_a->which_edge + 2) % 3; /* sets the .which_vertex_not part */
-
-  if(   ((edge_a->which_edge < 3) && (edge_b->which_edge < 3))
-        || ((edge_a->which_edge > 2) && (edge_b->which_edge > 2))) {
-    /* these facets are oriented in opposite directions.  */
-    /*  their normals are probably messed up. */
-    stl->neighbors_start[edge_a->facet_number].
-    which_vertex_not[edge_a->which_edge % 3] += 3;
-    stl->neighbors_start[edge_b->facet_number].
-    which_vertex_not[edge_b->which_edge % 3] += 3;
-  }
-
+  stl_connect_edges(stl, edge_a, edge_b);
 
   /* Count successful connects */
   /* Total connects */
@@ -428,6 +460,39 @@ stl_record_neighbors(stl_file *stl,
   }
 }
 
+/* Fill in the neighbors list of the two facets owning the matching edges.
+   Only the neighbor entries of the two edges are touched, so that disjoint pairs of edges
+   may be connected concurrently. */
+static void
+stl_connect_edges(stl_file *stl,
+                  const stl_hash_edge *edge_a, const stl_hash_edge *edge_b) {
+  /* Facet a's neighbor is facet b */
+  stl->neighbors_start[edge_a->facet_number].neighbor[edge_a->which_edge % 3] =
+    edge_b->facet_number;	/* sets the .neighbor part */
+
+  stl->neighbors_start[edge_a->facet_number].
+  which_vertex_not[edge_a->which_edge % 3] =
+    (edge_b->which_edge + 2) % 3; /* sets the .which_vertex_not part */
+
+  /* Facet b's neighbor is facet a */
+  stl->neighbors_start[edge_b->facet_number].neighbor[edge_b->which_edge % 3] =
+    edge_a->facet_number;	/* sets the .neighbor part */
+
+  stl->neighbors_start[edge_b->facet_number].
+  which_vertex_not[edge_b->which_edge % 3] =
+    (edge_a->which_edge + 2) % 3; /* sets the .which_vertex_not part */
+
+  if(   ((edge_a->which_edge < 3) && (edge_b->which_edge < 3))
+        || ((edge_a->which_edge > 2) && (edge_b->which_edge > 2))) {
+    /* these facets are oriented in opposite directions.  */
+    /*  their normals are probably messed up. */
+    stl->neighbors_start[edge_a->facet_number].
+    which_vertex_not[edge_a->which_edge % 3] += 3;
+    stl->neighbors_start[edge_b->facet_number].
+    which_vertex_not[edge_b->which_edge % 3] += 3;
+  }
+}
+
 static void stl_match_neighbors_nearby(stl_file *stl, stl_hash_edge *edge_a, stl_hash_edge *edge_b)
 {
   int facet1;
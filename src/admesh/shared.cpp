@@ -22,9 +22,15 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+
+#include <atomic>
+#include <vector>
 
 #include <boost/nowide/cstdio.hpp>
 
+#include <tbb/parallel_for.h>
+
 #include "stl.h"
 
 void
@@ -142,6 +148,166 @@ stl_generate_shared_vertices(stl_file *stl) {
   }
 }
 
+// Bit pattern of a vertex with negative zeros switched to positive zeros,
+// so that vertices comparing equal as floats share the same key.
+struct stl_vertex_key {
+  uint32_t key[3];
+
+  explicit stl_vertex_key(const stl_vertex &v) {
+    for (int i = 0; i < 3; ++ i) {
+      float f = (v(i) == 0.f) ? 0.f : v(i);
+      memcpy(&key[i], &f, sizeof(float));
+    }
+  }
+  bool operator==(const stl_vertex_key &rhs) const { return key[0] == rhs.key[0] && key[1] == rhs.key[1] && key[2] == rhs.key[2]; }
+};
+
+// The low bits of the float coordinates of "nice" vertices are mostly zero,
+// therefore the coordinates are mixed with the 64bit MurmurHash3 finalizer.
+static inline size_t stl_hash_3(uint64_t a, uint64_t b, uint64_t c, size_t mask) {
+  uint64_t h = (a * 0x9E3779B97F4A7C15ull) ^ (b * 0xC2B2AE3D27D4EB4Full) ^ (c * 0x165667B19E3779F9ull);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return size_t(h) & mask;
+}
+
+// Size of an open addressing hash table to be filled at most to a half.
+static inline size_t stl_hash_table_size(size_t num_entries) {
+  size_t size = 16;
+  while (size < 2 * num_entries)
+    size <<= 1;
+  return size;
+}
+
+/* Merge the facet vertices into a list of unique vertices. In contrast to stl_generate_shared_vertices(),
+   the facet connectivity is not used, so the mesh does not need to be repaired.
+   With tolerance == 0, vertices are merged if their coordinates are exactly equal.
+   With tolerance > 0, each vertex is merged with the first unique vertex closer than tolerance.
+   The unique vertices are stored in the order of their first occurence in the facet list,
+   indices[i] will contain the indices of the vertices of the i'th facet.
+   vertices shall have space for 3 * number_of_facets vertices, indices for number_of_facets facets.
+   Returns the number of the unique vertices. */
+size_t
+stl_weld_vertices(const stl_file *stl, float tolerance, stl_vertex *vertices, v_indices_struct *indices) {
+  if (stl->error) return 0;
+
+  const size_t num_corners = size_t(stl->stats.number_of_facets) * 3;
+  auto corner_vertex = [stl](size_t corner) -> const stl_vertex& { return stl->facet_start[corner / 3].vertex[corner % 3]; };
+
+  // Open addressing hash table of the corners. Each slot stores the lowest index of a corner with the slot's key,
+  // thus the content of the table does not depend on the order of the parallel insertions.
+  const size_t table_mask = stl_hash_table_size(num_corners) - 1;
+  std::vector<std::atomic<int>> table(table_mask + 1);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, table.size()), [&table](const tbb::blocked_range<size_t> &range) {
+    for (size_t i = range.begin(); i < range.end(); ++ i)
+      table[i].store(-1, std::memory_order_relaxed);
+  });
+  auto key_slot = [table_mask](const stl_vertex_key &key) { return stl_hash_3(key.key[0], key.key[1], key.key[2], table_mask); };
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, num_corners), [&table, table_mask, &key_slot, &corner_vertex](const tbb::blocked_range<size_t> &range) {
+    for (size_t corner = range.begin(); corner < range.end(); ++ corner) {
+      stl_vertex_key key(corner_vertex(corner));
+      for (size_t slot = key_slot(key);; slot = (slot + 1) & table_mask) {
+        int stored = -1;
+        if (table[slot].compare_exchange_strong(stored, int(corner)))
+          break;
+        if (key == stl_vertex_key(corner_vertex(stored))) {
+          // The slot only ever holds corners of this key, lower it to this corner.
+          while (int(corner) < stored && ! table[slot].compare_exchange_weak(stored, int(corner))) ;
+          break;
+        }
+      }
+    }
+  });
+
+  // For each corner, find the first corner sharing its vertex.
+  std::vector<int> first_corner(num_corners);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, num_corners), [&table, table_mask, &key_slot, &corner_vertex, &first_corner](const tbb::blocked_range<size_t> &range) {
+    for (size_t corner = range.begin(); corner < range.end(); ++ corner) {
+      stl_vertex_key key(corner_vertex(corner));
+      size_t slot = key_slot(key);
+      int    stored;
+      while (! (key == stl_vertex_key(corner_vertex(stored = table[slot].load(std::memory_order_relaxed)))))
+        slot = (slot + 1) & table_mask;
+      first_corner[corner] = stored;
+    }
+  });
+  table.clear();
+  table.shrink_to_fit();
+
+  // Number the unique vertices in the order of their first occurence.
+  // The first corner of a vertex is always visited before the other corners of the same vertex.
+  size_t num_vertices = 0;
+  for (size_t corner = 0; corner < num_corners; ++ corner)
+    if (first_corner[corner] == int(corner))
+      ++ num_vertices;
+  size_t num_stored = 0;
+  for (size_t corner = 0; corner < num_corners; ++ corner)
+    if (first_corner[corner] == int(corner)) {
+      first_corner[corner] = int(num_stored);
+      vertices[num_stored ++] = corner_vertex(corner);
+    } else
+      first_corner[corner] = first_corner[first_corner[corner]];
+
+  if (tolerance > 0.f) {
+    // Cluster the unique vertices in the order of their first occurence. The grid cells are twice the tolerance wide,
+    // therefore the vertices closer than tolerance are found in the cell of a vertex and in the 7 cells next to its closest cell corner.
+    // The grid is stored sparsely as a hash table of the first cluster in a cell, the clusters of a cell are chained.
+    // As a cluster index never exceeds the index of the vertex being clustered, the clusters are stored in place.
+    const float cell_size = 2.f * tolerance;
+    const float tolerance2 = tolerance * tolerance;
+    auto cell_of = [cell_size](const stl_vertex &v) { return Eigen::Matrix<int64_t, 3, 1>(int64_t(floor(v(0) / cell_size)), int64_t(floor(v(1) / cell_size)), int64_t(floor(v(2) / cell_size))); };
+    const size_t cell_mask = stl_hash_table_size(num_vertices) - 1;
+    std::vector<int> cell_table(cell_mask + 1, -1);
+    std::vector<int> next_in_cell(num_vertices, -1);
+    std::vector<int> cluster(num_vertices);
+    size_t num_clusters = 0;
+    for (size_t i = 0; i < num_vertices; ++ i) {
+      const stl_vertex v = vertices[i];
+      const Eigen::Matrix<int64_t, 3, 1> cell = cell_of(v);
+      int neighbor_dir[3];
+      for (int j = 0; j < 3; ++ j)
+        neighbor_dir[j] = (v(j) - float(cell(j)) * cell_size < tolerance) ? -1 : 1;
+      int found = -1;
+      for (int n = 0; n < 8; ++ n) {
+        Eigen::Matrix<int64_t, 3, 1> c = cell;
+        for (int j = 0; j < 3; ++ j)
+          if (n & (1 << j))
+            c(j) += neighbor_dir[j];
+        for (size_t slot = stl_hash_3(c(0), c(1), c(2), cell_mask); cell_table[slot] != -1; slot = (slot + 1) & cell_mask)
+          if (cell_of(vertices[cell_table[slot]]) == c) {
+            for (int idx = cell_table[slot]; idx != -1; idx = next_in_cell[idx])
+              if ((found == -1 || idx < found) && (vertices[idx] - v).squaredNorm() <= tolerance2)
+                found = idx;
+            break;
+          }
+      }
+      if (found == -1) {
+        found = int(num_clusters ++);
+        vertices[found] = v;
+        size_t slot = stl_hash_3(cell(0), cell(1), cell(2), cell_mask);
+        for (; cell_table[slot] != -1 && cell_of(vertices[cell_table[slot]]) != cell; slot = (slot + 1) & cell_mask) ;
+        next_in_cell[found] = cell_table[slot];
+        cell_table[slot] = found;
+      }
+      cluster[i] = found;
+    }
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_corners), [&first_corner, &cluster](const tbb::blocked_range<size_t> &range) {
+      for (size_t corner = range.begin(); corner < range.end(); ++ corner)
+        first_corner[corner] = cluster[first_corner[corner]];
+    });
+    num_vertices = num_clusters;
+  }
+
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, num_corners), [indices, &first_corner](const tbb::blocked_range<size_t> &range) {
+    for (size_t corner = range.begin(); corner < range.end(); ++ corner)
+      indices[corner / 3].vertex[corner % 3] = first_corner[corner];
+  });
+  return num_vertices;
+}
+
 void
 stl_write_off(stl_file *stl, char *file) {
   int i;
@@ -177,6 +177,7 @@ extern void stl_transform(stl_file *stl, const Eigen::Transform<double, 3, Eigen
 extern void stl_open_merge(stl_file *stl, char *file);
 extern void stl_invalidate_shared_vertices(stl_file *stl);
 extern void stl_generate_shared_vertices(stl_file *stl);
+extern size_t stl_weld_vertices(const stl_file *stl, float tolerance, stl_vertex *vertices, v_indices_struct *indices);
 extern void stl_write_obj(stl_file *stl, char *file);
 extern void stl_write_off(stl_file *stl, char *file);
 extern void stl_write_dxf(stl_file *stl, char *file, char *label);
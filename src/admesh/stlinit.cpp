@@ -26,6 +26,8 @@
 #include <math.h>
 #include <assert.h>
 
+#include <vector>
+
 #include <boost/nowide/cstdio.hpp>
 #include <boost/detail/endian.hpp>
 
@@ -252,73 +254,166 @@ stl_reallocate(stl_file *stl) {
 }
 
 
+// Buffered tokenizer of an ASCII STL file, replacing the sequence of fscanf() calls per facet.
+// The file is read in large blocks, tokens are zero terminated in place and never cross a block boundary.
+class StlAsciiTokenizer {
+public:
+  StlAsciiTokenizer(FILE *fp) : m_fp(fp), m_buf(0x100000 + 1), m_pos(0), m_len(0), m_eof(false), m_last_delimiter(0) {}
+
+  // Returns the next white space delimited token, or nullptr at the end of the file.
+  char* next() {
+    for (;;) {
+      while (m_pos < m_len && is_space(m_buf[m_pos]))
+        ++ m_pos;
+      if (m_pos == m_len) {
+        if (! this->refill())
+          return nullptr;
+        continue;
+      }
+      size_t end = m_pos;
+      while (end < m_len && ! is_space(m_buf[end]))
+        ++ end;
+      if (end == m_len && ! m_eof) {
+        // The token may continue in the next block. Scan it again, as refill() moves the data
+        // to the start of the buffer even if there is nothing more to read.
+        this->refill();
+        continue;
+      }
+      char *token = m_buf.data() + m_pos;
+      m_last_delimiter = (end < m_len) ? m_buf[end] : 0;
+      m_buf[end] = 0;
+      m_pos = (end < m_len) ? end + 1 : end;
+      return token;
+    }
+  }
+
+  // Skips the rest of the line of the last token returned.
+  void skip_line() {
+    if (m_last_delimiter == '\n')
+      return;
+    for (;;) {
+      while (m_pos < m_len && m_buf[m_pos] != '\n')
+        ++ m_pos;
+      if (m_pos < m_len || ! this->refill())
+        break;
+    }
+    m_last_delimiter = '\n';
+  }
+
+private:
+  static bool is_space(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f'; }
+
+  // Moves the unprocessed data to the start of the buffer and reads the next block of the file.
+  // Returns false if no more data was read.
+  bool refill() {
+    if (m_eof)
+      return false;
+    if (m_pos > 0) {
+      memmove(m_buf.data(), m_buf.data() + m_pos, m_len - m_pos);
+      m_len -= m_pos;
+      m_pos  = 0;
+    }
+    if (m_len + 1 == m_buf.size())
+      // A single token fills the whole buffer.
+      m_buf.resize(m_buf.size() * 2);
+    size_t n = fread(m_buf.data() + m_len, 1, m_buf.size() - 1 - m_len, m_fp);
+    if (n == 0) {
+      m_eof = true;
+      return false;
+    }
+    m_len += n;
+    return true;
+  }
+
+  FILE             *m_fp;
+  // One more byte than the block size to zero terminate the last token of the file.
+  std::vector<char> m_buf;
+  size_t            m_pos;
+  size_t            m_len;
+  bool              m_eof;
+  char              m_last_delimiter;
+};
+
+// Parses a single facet of an ASCII STL file. Returns false on a syntax error.
+static bool stl_read_ascii_facet(StlAsciiTokenizer &tokenizer, stl_facet &facet)
+{
+  char *token = tokenizer.next();
+  // skip solid/endsolid, as broken STL file generators may put several of them
+  // (the name might contain spaces and it also can be empty, just "solid").
+  while (token != nullptr && (strncmp(token, "solid", 5) == 0 || strncmp(token, "endsolid", 8) == 0)) {
+    tokenizer.skip_line();
+    token = tokenizer.next();
+  }
+  auto expect = [&tokenizer](const char *keyword) { const char *token = tokenizer.next(); return token != nullptr && strcmp(token, keyword) == 0; };
+  // A vertex coordinate has to be a number as a whole, while the normal is parsed from the start of the token,
+  // as it used to be parsed by fscanf() and sscanf().
+  auto read_float = [&tokenizer](float &value, bool whole_token) {
+    const char *token = tokenizer.next();
+    if (token == nullptr)
+      return false;
+    char *end;
+    value = strtof(token, &end);
+    return end != token && (! whole_token || *end == 0);
+  };
+  if (token == nullptr || strcmp(token, "facet") != 0 || ! expect("normal"))
+    return false;
+  // The facet normal is parsed leniently to workaround for not a numbers in the normal definition.
+  bool normal_valid = true;
+  for (int i = 0; i < 3; ++ i)
+    if (! read_float(facet.normal(i), false))
+      normal_valid = false;
+  if (! normal_valid)
+    // Normal was mangled. Maybe denormals or "not a number" were stored?
+    // Just reset the normal and silently ignore it.
+    memset(&facet.normal, 0, sizeof(facet.normal));
+  if (! expect("outer") || ! expect("loop"))
+    return false;
+  for (int i = 0; i < 3; ++ i)
+    if (! expect("vertex") || ! read_float(facet.vertex[i](0), true) || ! read_float(facet.vertex[i](1), true) || ! read_float(facet.vertex[i](2), true))
+      return false;
+  return expect("endloop") && expect("endfacet");
+}
+
 /* Reads the contents of the file pointed to by stl->fp into the stl structure,
    starting at facet first_facet.  The second argument says if it's our first
    time running this for the stl and therefore we should reset our max and min stats. */
 void stl_read(stl_file *stl, int first_facet, bool first) {
-  stl_facet facet;
-  int   i;
-
   if (stl->error) return;
 
   if(stl->stats.type == binary) {
     fseek(stl->fp, HEADER_SIZE, SEEK_SET);
-  } else {
-    rewind(stl->fp);
-  }
-
-  char normal_buf[3][32];
-  for(i = first_facet; i < stl->stats.number_of_facets; i++) {
-    if(stl->stats.type == binary)
-      /* Read a single facet from a binary .STL file */
-    {
-      /* we assume little-endian architecture! */
-      if (fread(&facet, 1, SIZEOF_STL_FACET, stl->fp) != SIZEOF_STL_FACET) {
-        stl->error = 1;
-        return;
-      }
+    // Read all the facets with a single call directly into the facet array.
+    // The facets are stored packed in the file, SIZEOF_STL_FACET bytes each.
+    size_t num_facets = stl->stats.number_of_facets - first_facet;
+    char  *data       = (char*)(stl->facet_start + first_facet);
+    if (fread(data, SIZEOF_STL_FACET, num_facets, stl->fp) != num_facets) {
+      stl->error = 1;
+      return;
+    }
+    // Spread the packed facets to their places in the facet array. Start with the last facet,
+    // so that no facet is overwritten before it is moved.
+    if (sizeof(stl_facet) != SIZEOF_STL_FACET)
+      for (size_t i = num_facets; i -- > 0;)
+        memmove((char*)(stl->facet_start + first_facet + i), data + i * SIZEOF_STL_FACET, SIZEOF_STL_FACET);
+    for (int i = first_facet; i < stl->stats.number_of_facets; ++ i) {
+      stl_facet &facet = stl->facet_start[i];
 #ifndef BOOST_LITTLE_ENDIAN
       // Convert the loaded little endian data to big endian.
       stl_internal_reverse_quads((char*)&facet, 48);
 #endif /* BOOST_LITTLE_ENDIAN */
-    } else
-      /* Read a single facet from an ASCII .STL file */
-    {
-      // skip solid/endsolid
-      // (in this order, otherwise it won't work when they are paired in the middle of a file)
-      fscanf(stl->fp, "endsolid%*[^\n]\n");
-      fscanf(stl->fp, "solid%*[^\n]\n");  // name might contain spaces so %*s doesn't work and it also can be empty (just "solid")
-      // Leading space in the fscanf format skips all leading white spaces including numerous new lines and tabs.
-      int res_normal     = fscanf(stl->fp, " facet normal %31s %31s %31s", normal_buf[0], normal_buf[1], normal_buf[2]);
-      assert(res_normal == 3);
-      int res_outer_loop = fscanf(stl->fp, " outer loop");
-      assert(res_outer_loop == 0);
-      int res_vertex1    = fscanf(stl->fp, " vertex %f %f %f", &facet.vertex[0](0), &facet.vertex[0](1), &facet.vertex[0](2));
-      assert(res_vertex1 == 3);
-      int res_vertex2    = fscanf(stl->fp, " vertex %f %f %f", &facet.vertex[1](0), &facet.vertex[1](1), &facet.vertex[1](2));
-      assert(res_vertex2 == 3);
-      int res_vertex3    = fscanf(stl->fp, " vertex %f %f %f", &facet.vertex[2](0), &facet.vertex[2](1), &facet.vertex[2](2));
-      assert(res_vertex3 == 3);
-      int res_endloop    = fscanf(stl->fp, " endloop");
-      assert(res_endloop == 0);
-      // There is a leading and trailing white space around endfacet to eat up all leading and trailing white spaces including numerous tabs and new lines.
-      int res_endfacet   = fscanf(stl->fp, " endfacet ");
-      if (res_normal != 3 || res_outer_loop != 0 || res_vertex1 != 3 || res_vertex2 != 3 || res_vertex3 != 3 || res_endloop != 0 || res_endfacet != 0) {
+      stl_facet_stats(stl, facet, first);
+    }
+  } else {
+    rewind(stl->fp);
+    StlAsciiTokenizer tokenizer(stl->fp);
+    for (int i = first_facet; i < stl->stats.number_of_facets; ++ i) {
+      stl_facet facet;
+      if (! stl_read_ascii_facet(tokenizer, facet)) {
         perror("Something is syntactically very wrong with this ASCII STL!");
         stl->error = 1;
         return;
       }
 
-      // The facet normal has been parsed as a single string as to workaround for not a numbers in the normal definition.
-	  if (sscanf(normal_buf[0], "%f", &facet.normal(0)) != 1 ||
-		  sscanf(normal_buf[1], "%f", &facet.normal(1)) != 1 ||
-		  sscanf(normal_buf[2], "%f", &facet.normal(2)) != 1) {
-		  // Normal was mangled. Maybe denormals or "not a number" were stored?
-		  // Just reset the normal and silently ignore it.
-		  memset(&facet.normal, 0, sizeof(facet.normal));
-	  }
-    }
-
 #if 0
       // Report close to zero vertex coordinates. Due to the nature of the floating point numbers,
       // close to zero values may be represented with singificantly higher precision than the rest of the vertices.
@@ -334,9 +429,10 @@ void stl_read(stl_file *stl, int first_facet, bool first) {
       }
 #endif
 
-    /* Write the facet into memory. */
-    stl->facet_start[i] = facet;
-    stl_facet_stats(stl, facet, first);
+      /* Write the facet into memory. */
+      stl->facet_start[i] = facet;
+      stl_facet_stats(stl, facet, first);
+    }
   }
   stl->stats.size = stl->stats.max - stl->stats.min;
   stl->stats.bounding_diameter = stl->stats.size.norm();
@@ -214,28 +214,58 @@ void ConfigBase::apply_only(const ConfigBase &other, const t_config_option_keys
     }
 }
 
+// Call fn(opt_key, this_opt, other_opt) for all options present in both configs.
+// If other is a DynamicConfig, its sorted table of options is walked in lockstep with the keys of config,
+// which are sorted for both the static and the dynamic configs, instead of looking up the keys one by one.
+template<typename Fn>
+static void for_each_common_option(const ConfigBase &config, const ConfigBase &other, Fn fn)
+{
+    const DynamicConfig *other_dynamic = dynamic_cast<const DynamicConfig*>(&other);
+    if (other_dynamic == nullptr) {
+        for (const t_config_option_key &opt_key : config.keys()) {
+            const ConfigOption *this_opt  = config.option(opt_key);
+            const ConfigOption *other_opt = other.option(opt_key);
+            if (this_opt != nullptr && other_opt != nullptr)
+                fn(opt_key, *this_opt, *other_opt);
+        }
+        return;
+    }
+    auto it_other     = other_dynamic->cbegin();
+    auto it_other_end = other_dynamic->cend();
+    const t_config_option_key *opt_key_prev = nullptr;
+    t_config_option_keys keys = config.keys();
+    for (const t_config_option_key &opt_key : keys) {
+        if (opt_key_prev != nullptr && opt_key < *opt_key_prev)
+            // Not sorted, restart the search.
+            it_other = other_dynamic->cbegin();
+        opt_key_prev = &opt_key;
+        for (; it_other != it_other_end && it_other->first < opt_key; ++ it_other) ;
+        if (it_other == it_other_end || it_other->first != opt_key)
+            continue;
+        const ConfigOption *this_opt = config.option(opt_key);
+        if (this_opt != nullptr)
+            fn(opt_key, *this_opt, *it_other->second);
+    }
+}
+
 // this will *ignore* options not present in both configs
 t_config_option_keys ConfigBase::diff(const ConfigBase &other) const
 {
     t_config_option_keys diff;
-    for (const t_config_option_key &opt_key : this->keys()) {
-        const ConfigOption *this_opt  = this->option(opt_key);
-        const ConfigOption *other_opt = other.option(opt_key);
-        if (this_opt != nullptr && other_opt != nullptr && *this_opt != *other_opt)
+    for_each_common_option(*this, other, [&diff](const t_config_option_key &opt_key, const ConfigOption &this_opt, const ConfigOption &other_opt) {
+        if (this_opt != other_opt)
             diff.emplace_back(opt_key);
-    }
+    });
     return diff;
 }
 
 t_config_option_keys ConfigBase::equal(const ConfigBase &other) const
 {
     t_config_option_keys equal;
-    for (const t_config_option_key &opt_key : this->keys()) {
-        const ConfigOption *this_opt  = this->option(opt_key);
-        const ConfigOption *other_opt = other.option(opt_key);
-        if (this_opt != nullptr && other_opt != nullptr && *this_opt == *other_opt)
+    for_each_common_option(*this, other, [&equal](const t_config_option_key &opt_key, const ConfigOption &this_opt, const ConfigOption &other_opt) {
+        if (this_opt == other_opt)
             equal.emplace_back(opt_key);
-    }
+    });
     return equal;
 }
 
@@ -417,7 +447,7 @@ size_t ConfigBase::load_from_gcode_string(const char* str)
     char *data_start = const_cast<char*>(str);
     // boost::nowide::ifstream seems to cook the text data somehow, so less then the 64k of characters may be retrieved.
     char *end = data_start + strlen(str);
-    size_t num_key_value_pairs = 0;
+    std::vector<std::pair<const char*, const char*>> key_values;
     for (;;) {
         // Extract next line.
         for (--end; end > data_start && (*end == '\r' || *end == '\n'); --end);
@@ -453,14 +483,21 @@ size_t ConfigBase::load_from_gcode_string(const char* str)
             }
         if (key == nullptr)
             break;
+        key_values.emplace_back(key, value);
+        end = start;
+    }
+
+    // Apply the key = value pairs in the order of the file, which is the order of the keys, if the G-code was exported
+    // by Slic3r. Thus a DynamicConfig appends the options to its sorted table instead of inserting each at the front.
+    size_t num_key_value_pairs = 0;
+    for (auto it = key_values.rbegin(); it != key_values.rend(); ++ it) {
         try {
-            this->set_deserialize(key, value);
+            this->set_deserialize(it->first, it->second);
             ++num_key_value_pairs;
         }
         catch (UnknownOptionException & /* e */) {
             // ignore
         }
-        end = start;
     }
 
 	return num_key_value_pairs;
@@ -491,8 +528,8 @@ bool DynamicConfig::operator==(const DynamicConfig &rhs) const
 
 ConfigOption* DynamicConfig::optptr(const t_config_option_key &opt_key, bool create)
 {
-    t_options_map::iterator it = options.find(opt_key);
-    if (it != options.end())
+    t_options_map::iterator it = this->lower_bound_option(opt_key);
+    if (it != options.end() && it->first == opt_key)
         // Option was found.
         return it->second;
     if (! create)
@@ -525,7 +562,7 @@ ConfigOption* DynamicConfig::optptr(const t_config_option_key &opt_key, bool cre
     case coEnum:            opt = new ConfigOptionEnumGeneric(optdef->enum_keys_map); break;
     default:                throw std::runtime_error(std::string("Unknown option type for option ") + opt_key);
     }
-    this->options[opt_key] = opt;
+    this->options.emplace(it, opt_key, opt);
     return opt;
 }
 
@@ -2,6 +2,7 @@
 #define slic3r_Config_hpp_
 
 #include <assert.h>
+#include <algorithm>
 #include <map>
 #include <climits>
 #include <cstdio>
@@ -1143,8 +1144,9 @@ public:
     {
         assert(this->def() == nullptr || this->def() == rhs.def());
         this->clear();
+        this->options.reserve(rhs.options.size());
         for (const auto &kvp : rhs.options)
-            this->options[kvp.first] = kvp.second->clone();
+            this->options.emplace_back(kvp.first, kvp.second->clone());
         return *this;
     }
 
@@ -1164,20 +1166,17 @@ public:
     DynamicConfig& operator+=(const DynamicConfig &rhs)
     {
         assert(this->def() == nullptr || this->def() == rhs.def());
-        for (const auto &kvp : rhs.options) {
-            auto it = this->options.find(kvp.first);
-            if (it == this->options.end())
-                this->options[kvp.first] = kvp.second->clone();
-            else {
-                assert(it->second->type() == kvp.second->type());
-                if (it->second->type() == kvp.second->type())
-                    *it->second = *kvp.second;
+        this->merge_options(rhs.options, 
+            [](const ConfigOption *src) { return src->clone(); },
+            [](ConfigOption *&dst, const ConfigOption *src) {
+                assert(dst->type() == src->type());
+                if (dst->type() == src->type())
+                    *dst = *src;
                 else {
-                    delete it->second;
-                    it->second = kvp.second->clone();
+                    delete dst;
+                    dst = src->clone();
                 }
-            }
-        }
+            });
         return *this;
     }
 
@@ -1186,16 +1185,13 @@ public:
     DynamicConfig& operator+=(DynamicConfig &&rhs) 
     {
         assert(this->def() == nullptr || this->def() == rhs.def());
-        for (const auto &kvp : rhs.options) {
-            auto it = this->options.find(kvp.first);
-            if (it == this->options.end()) {
-                this->options[kvp.first] = kvp.second;
-            } else {
-                assert(it->second->type() == kvp.second->type());
-                delete it->second;
-                it->second = kvp.second;
-            }
-        }
+        this->merge_options(rhs.options, 
+            [](ConfigOption *src) { return src; },
+            [](ConfigOption *&dst, ConfigOption *src) {
+                assert(dst->type() == src->type());
+                delete dst;
+                dst = src;
+            });
         rhs.options.clear();
         return *this;
     }
@@ -1217,7 +1213,7 @@ public:
 
     bool erase(const t_config_option_key &opt_key)
     { 
-        auto it = this->options.find(opt_key);
+        auto it = this->find_option(opt_key);
         if (it == this->options.end())
             return false;
         delete it->second;
@@ -1243,9 +1239,9 @@ public:
     // Be careful, as this method does not test the existence of opt_key in this->def().
     bool                    set_key_value(const std::string &opt_key, ConfigOption *opt)
     {
-        auto it = this->options.find(opt_key);
-        if (it == this->options.end()) {
-            this->options[opt_key] = opt;
+        auto it = this->lower_bound_option(opt_key);
+        if (it == this->options.end() || it->first != opt_key) {
+            this->options.emplace(it, opt_key, opt);
             return true;
         } else {
             delete it->second;
@@ -1279,11 +1275,49 @@ public:
     void                read_cli(const std::vector<std::string> &tokens, t_config_option_keys* extra);
     bool                read_cli(int argc, char** argv, t_config_option_keys* extra);
 
-    typedef std::map<t_config_option_key,ConfigOption*> t_options_map;
+    // The options are stored in a flat table sorted by the option keys, thus an option is looked up by a binary search
+    // over a contiguous block of memory and two configs are compared by a single linear pass over their tables.
+    typedef std::vector<std::pair<t_config_option_key, ConfigOption*>> t_options_map;
     t_options_map::const_iterator cbegin() const { return options.cbegin(); }
     t_options_map::const_iterator cend()   const { return options.cend(); }
 
 private:
+    // First option with a key not less than opt_key.
+    // The configs are mostly filled in the order of the keys (the keys of the static configs, the config files),
+    // thus a key past the last one is appended without a search and without moving the other options.
+    t_options_map::iterator lower_bound_option(const t_config_option_key &opt_key) {
+        if (this->options.empty() || this->options.back().first < opt_key)
+            return this->options.end();
+        return std::lower_bound(this->options.begin(), this->options.end(), opt_key, 
+            [](const t_options_map::value_type &kvp, const t_config_option_key &key) { return kvp.first < key; });
+    }
+    t_options_map::iterator find_option(const t_config_option_key &opt_key) {
+        auto it = this->lower_bound_option(opt_key);
+        return (it == this->options.end() || it->first != opt_key) ? this->options.end() : it;
+    }
+
+    // Merge the sorted options of src into this->options. For the options of src missing in this->options,
+    // the result of fn_new(src_option) is inserted, otherwise fn_existing(this_option, src_option) is called.
+    template<typename SrcOptionsMap, typename FnNew, typename FnExisting>
+    void merge_options(SrcOptionsMap &src, FnNew fn_new, FnExisting fn_existing)
+    {
+        t_options_map merged;
+        merged.reserve(this->options.size() + src.size());
+        auto it_this = this->options.begin();
+        for (auto &kvp : src) {
+            for (; it_this != this->options.end() && it_this->first < kvp.first; ++ it_this)
+                merged.emplace_back(std::move(*it_this));
+            if (it_this != this->options.end() && it_this->first == kvp.first) {
+                fn_existing(it_this->second, kvp.second);
+                merged.emplace_back(std::move(*it_this ++));
+            } else
+                merged.emplace_back(kvp.first, fn_new(kvp.second));
+        }
+        for (; it_this != this->options.end(); ++ it_this)
+            merged.emplace_back(std::move(*it_this));
+        this->options = std::move(merged);
+    }
+
     t_options_map options;
 };
 
@@ -1229,6 +1229,20 @@ bool EdgeGrid::Grid::signed_distance(const Point &pt, coord_t search_radius, coo
 	return true;
 }
 
+bool EdgeGrid::Grid::signed_distance_each(const Points &pts, coord_t search_radius, std::vector<coordf_t> &result_min_dists) const
+{
+	result_min_dists.assign(pts.size(), 0.);
+	bool all_found = true;
+	for (size_t i = 0; i < pts.size(); ++ i)
+		if (! signed_distance_edges(pts[i], search_radius, result_min_dists[i])) {
+			if (m_signed_distance_field.empty())
+				all_found = false;
+			else
+				result_min_dists[i] = signed_distance_bilinear(pts[i]);
+		}
+	return all_found;
+}
+
 Polygons EdgeGrid::Grid::contours_simplified(coord_t offset, bool fill_holes) const
 {
 	assert(std::abs(2 * offset) < m_resolution);
@@ -51,6 +51,9 @@ public:
 	// Calculate a signed distance to the contours in search_radius from the point. If no edge is found in search_radius,
 	// return an interpolated value from m_signed_distance_field, if it exists.
 	bool signed_distance(const Point &pt, coord_t search_radius, coordf_t &result_min_dist) const;
+	// Convenience wrapper calling signed_distance() for each of the points, the grid is searched for each point separately.
+	// Returns false if the distance of any of the points is not known.
+	bool signed_distance_each(const Points &pts, coord_t search_radius, std::vector<coordf_t> &result_min_dists) const;
 
 	const BoundingBox& 	bbox() const { return m_bbox; }
 	const coord_t 		resolution() const { return m_resolution; }
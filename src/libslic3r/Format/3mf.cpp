@@ -16,6 +16,12 @@
 #include <Eigen/Dense>
 #include <miniz/miniz_zip.h>
 
+#include <tbb/parallel_for.h>
+#include <tbb/pipeline.h>
+#include <tbb/task_scheduler_init.h>
+
+#include <mutex>
+
 // VERSION NUMBERS
 // 0 : .3mf, files saved by older slic3r or other applications. No version definition in them.
 // 1 : Introduction of 3mf versioning. No other change in data saved into 3mf files.
@@ -109,16 +115,102 @@ std::string get_attribute_value_string(const char** attributes, unsigned int att
     return (text != nullptr) ? text : "";
 }
 
+// Same result as ::atof(), but faster for the plain decimal numbers stored by the 3mf files, like "-12.345678" or "1.5e-3".
+// Such a number with a mantissa below 2^53 and a decimal exponent up to 22 is converted by a single correctly rounded
+// floating point multiplication or division. Anything else (white spaces, long mantissas, large exponents, inf, nan ...)
+// is left to ::atof().
+double fast_atof(const char* text)
+{
+    static const double pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char* c = text;
+    bool negative = *c == '-';
+    if (*c == '-' || *c == '+')
+        ++c;
+
+    uint64_t mantissa = 0;
+    int num_digits = 0;
+    int num_significant_digits = 0;
+    int exponent = 0;
+    for (; *c >= '0' && *c <= '9'; ++c, ++num_digits)
+    {
+        mantissa = mantissa * 10 + (*c - '0');
+        if ((mantissa != 0) && (++num_significant_digits > 19))
+            return ::atof(text);
+    }
+    if (*c == '.')
+    {
+        for (++c; *c >= '0' && *c <= '9'; ++c, ++num_digits, --exponent)
+        {
+            mantissa = mantissa * 10 + (*c - '0');
+            if ((mantissa != 0) && (++num_significant_digits > 19))
+                return ::atof(text);
+        }
+    }
+    if (num_digits == 0)
+        return ::atof(text);
+    if ((*c == 'e') || (*c == 'E'))
+    {
+        ++c;
+        bool negative_exponent = *c == '-';
+        if (*c == '-' || *c == '+')
+            ++c;
+        int exp = 0;
+        int num_exp_digits = 0;
+        for (; *c >= '0' && *c <= '9'; ++c)
+        {
+            exp = exp * 10 + (*c - '0');
+            if (++num_exp_digits > 4)
+                return ::atof(text);
+        }
+        if (num_exp_digits == 0)
+            return ::atof(text);
+        exponent += negative_exponent ? -exp : exp;
+    }
+
+    if ((*c != 0) || (mantissa > (uint64_t(1) << 53)) || (exponent < -22) || (exponent > 22))
+        return ::atof(text);
+
+    double value = (exponent < 0) ? (double)mantissa / pow10[-exponent] : (double)mantissa * pow10[exponent];
+    return negative ? -value : value;
+}
+
+// Same result as ::atoi() for the numbers, which fit into an int.
+int fast_atoi(const char* text)
+{
+    const char* c = text;
+    bool negative = *c == '-';
+    if (*c == '-' || *c == '+')
+        ++c;
+
+    int value = 0;
+    int num_digits = 0;
+    for (; *c >= '0' && *c <= '9'; ++c)
+    {
+        value = value * 10 + (*c - '0');
+        if (++num_digits > 9)
+            return ::atoi(text);
+    }
+
+    if ((*c != 0) || (num_digits == 0))
+        return ::atoi(text);
+
+    return negative ? -value : value;
+}
+
 float get_attribute_value_float(const char** attributes, unsigned int attributes_size, const char* attribute_key)
 {
     const char* text = get_attribute_value_charptr(attributes, attributes_size, attribute_key);
-    return (text != nullptr) ? (float)::atof(text) : 0.0f;
+    return (text != nullptr) ? (float)fast_atof(text) : 0.0f;
 }
 
 int get_attribute_value_int(const char** attributes, unsigned int attributes_size, const char* attribute_key)
 {
     const char* text = get_attribute_value_charptr(attributes, attributes_size, attribute_key);
-    return (text != nullptr) ? ::atoi(text) : 0;
+    return (text != nullptr) ? fast_atoi(text) : 0;
 }
 
 Slic3r::Transform3d get_transform_from_string(const std::string& mat_str)
@@ -189,9 +281,11 @@ namespace Slic3r {
     class _3MF_Base
     {
         std::vector<std::string> m_errors;
+        // errors may be reported by the objects exported in parallel
+        std::mutex m_errors_mutex;
 
     protected:
-        void add_error(const std::string& error) { m_errors.push_back(error); }
+        void add_error(const std::string& error) { std::lock_guard<std::mutex> lock(m_errors_mutex); m_errors.push_back(error); }
         void clear_errors() { m_errors.clear(); }
 
     public:
@@ -320,6 +414,25 @@ namespace Slic3r {
         typedef std::map<int, ModelObject*> IdToModelObjectMap;
         typedef std::map<int, ComponentsList> IdToAliasesMap;
         typedef std::vector<Instance> InstancesList;
+        // Mesh of a volume to be filled in from the imported geometry.
+        struct VolumeMesh
+        {
+            ModelVolume* volume;
+            const Geometry* geometry;
+            unsigned int first_triangle_id;
+            unsigned int triangles_count;
+
+            VolumeMesh(ModelVolume* volume, const Geometry* geometry, unsigned int first_triangle_id, unsigned int triangles_count)
+                : volume(volume)
+                , geometry(geometry)
+                , first_triangle_id(first_triangle_id)
+                , triangles_count(triangles_count)
+            {
+            }
+        };
+
+        typedef std::vector<VolumeMesh> VolumeMeshesList;
+
         typedef std::map<int, ObjectMetadata> IdToMetadataMap;
         typedef std::map<int, Geometry> IdToGeometryMap;
         typedef std::map<int, std::vector<coordf_t>> IdToLayerHeightsProfileMap;
@@ -426,7 +539,8 @@ namespace Slic3r {
         bool _handle_start_config_metadata(const char** attributes, unsigned int num_attributes);
         bool _handle_end_config_metadata();
 
-        bool _generate_volumes(ModelObject& object, const Geometry& geometry, const ObjectMetadata::VolumeMetadataList& volumes);
+        bool _generate_volumes(ModelObject& object, const Geometry& geometry, const ObjectMetadata::VolumeMetadataList& volumes, VolumeMeshesList& meshes);
+        static void _generate_volume_mesh(const VolumeMesh& mesh);
 
         // callbacks to parse the .model file
         static void XMLCALL _handle_start_model_xml_element(void* userData, const char* name, const char** attributes);
@@ -568,6 +682,7 @@ namespace Slic3r {
 
         mz_zip_reader_end(&archive);
 
+        VolumeMeshesList meshes;
         for (const IdToModelObjectMap::value_type& object : m_objects)
         {
             ObjectMetadata::VolumeMetadataList volumes;
@@ -616,10 +731,17 @@ namespace Slic3r {
                 volumes_ptr = &volumes;
             }
 
-            if (!_generate_volumes(*object.second, obj_geometry->second, *volumes_ptr))
+            if (!_generate_volumes(*object.second, obj_geometry->second, *volumes_ptr, meshes))
                 return false;
         }
 
+        // the meshes of the volumes are independent one from the other, they are repaired and their convex hulls calculated in parallel
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, meshes.size(), 1),
+            [&meshes](const tbb::blocked_range<size_t>& range) {
+                for (size_t i = range.begin(); i < range.end(); ++i)
+                    _generate_volume_mesh(meshes[i]);
+            });
+
         // fixes the min z of the model if negative
         model.adjust_min_z();
 
@@ -647,28 +769,30 @@ namespace Slic3r {
         XML_SetElementHandler(m_xml_parser, _3MF_Importer::_handle_start_model_xml_element, _3MF_Importer::_handle_end_model_xml_element);
         XML_SetCharacterDataHandler(m_xml_parser, _3MF_Importer::_handle_model_xml_characters);
 
-        void* parser_buffer = XML_GetBuffer(m_xml_parser, (int)stat.m_uncomp_size);
-        if (parser_buffer == nullptr)
+        // The model file is parsed while being inflated chunk by chunk, so that the whole xml is never held in memory.
+        mz_file_write_func parse_chunk = [](void* pOpaque, mz_uint64 file_ofs, const void* pBuf, size_t n) -> size_t {
+            return (XML_Parse((XML_Parser)pOpaque, (const char*)pBuf, (int)n, 0) == XML_STATUS_OK) ? n : 0;
+        };
+
+        mz_bool res = mz_zip_reader_extract_to_callback(&archive, stat.m_file_index, parse_chunk, (void*)m_xml_parser, 0);
+        if (res != 0)
+            // signal the end of the document
+            XML_Parse(m_xml_parser, nullptr, 0, 1);
+
+        if (XML_GetErrorCode(m_xml_parser) != XML_ERROR_NONE)
         {
-            add_error("Unable to create buffer");
+            char error_buf[1024];
+            ::sprintf(error_buf, "Error (%s) while parsing xml file at line %d", XML_ErrorString(XML_GetErrorCode(m_xml_parser)), XML_GetCurrentLineNumber(m_xml_parser));
+            add_error(error_buf);
             return false;
         }
 
-        mz_bool res = mz_zip_reader_extract_file_to_mem(&archive, stat.m_filename, parser_buffer, (size_t)stat.m_uncomp_size, 0);
         if (res == 0)
         {
             add_error("Error while reading model data to buffer");
             return false;
         }
 
-        if (!XML_ParseBuffer(m_xml_parser, (int)stat.m_uncomp_size, 1))
-        {
-            char error_buf[1024];
-            ::sprintf(error_buf, "Error (%s) while parsing xml file at line %d", XML_ErrorString(XML_GetErrorCode(m_xml_parser)), XML_GetCurrentLineNumber(m_xml_parser));
-            add_error(error_buf);
-            return false;
-        }
-
         return true;
     }
 
@@ -1433,7 +1557,7 @@ namespace Slic3r {
         return true;
     }
 
-    bool _3MF_Importer::_generate_volumes(ModelObject& object, const Geometry& geometry, const ObjectMetadata::VolumeMetadataList& volumes)
+    bool _3MF_Importer::_generate_volumes(ModelObject& object, const Geometry& geometry, const ObjectMetadata::VolumeMetadataList& volumes, VolumeMeshesList& meshes)
     {
         if (!object.volumes.empty())
         {
@@ -1451,31 +1575,10 @@ namespace Slic3r {
                 return false;
             }
 
-            // splits volume out of imported geometry
+            // splits volume out of imported geometry, the mesh will be filled in by _generate_volume_mesh()
             unsigned int triangles_count = volume_data.last_triangle_id - volume_data.first_triangle_id + 1;
             ModelVolume* volume = object.add_volume(TriangleMesh());
-            stl_file& stl = volume->mesh.stl;
-            stl.stats.type = inmemory;
-            stl.stats.number_of_facets = (uint32_t)triangles_count;
-            stl.stats.original_num_facets = (int)stl.stats.number_of_facets;
-            stl_allocate(&stl);
-
-            unsigned int src_start_id = volume_data.first_triangle_id * 3;
-
-            for (unsigned int i = 0; i < triangles_count; ++i)
-            {
-                unsigned int ii = i * 3;
-                stl_facet& facet = stl.facet_start[i];
-                for (unsigned int v = 0; v < 3; ++v)
-                {
-                    ::memcpy(facet.vertex[v].data(), (const void*)&geometry.vertices[geometry.triangles[src_start_id + ii + v] * 3], 3 * sizeof(float));
-                }
-            }
-
-            stl_get_size(&stl);
-            volume->mesh.repair();
-            volume->center_geometry();
-            volume->calculate_convex_hull();
+            meshes.emplace_back(volume, &geometry, volume_data.first_triangle_id, triangles_count);
 
             // apply volume's name and config data
             for (const Metadata& metadata : volume_data.metadata)
@@ -1494,6 +1597,34 @@ namespace Slic3r {
         return true;
     }
 
+    void _3MF_Importer::_generate_volume_mesh(const VolumeMesh& mesh)
+    {
+        const Geometry& geometry = *mesh.geometry;
+        ModelVolume* volume = mesh.volume;
+        stl_file& stl = volume->mesh.stl;
+        stl.stats.type = inmemory;
+        stl.stats.number_of_facets = (uint32_t)mesh.triangles_count;
+        stl.stats.original_num_facets = (int)stl.stats.number_of_facets;
+        stl_allocate(&stl);
+
+        unsigned int src_start_id = mesh.first_triangle_id * 3;
+
+        for (unsigned int i = 0; i < mesh.triangles_count; ++i)
+        {
+            unsigned int ii = i * 3;
+            stl_facet& facet = stl.facet_start[i];
+            for (unsigned int v = 0; v < 3; ++v)
+            {
+                ::memcpy(facet.vertex[v].data(), (const void*)&geometry.vertices[geometry.triangles[src_start_id + ii + v] * 3], 3 * sizeof(float));
+            }
+        }
+
+        stl_get_size(&stl);
+        volume->mesh.repair();
+        volume->center_geometry();
+        volume->calculate_convex_hull();
+    }
+
     void XMLCALL _3MF_Importer::_handle_start_model_xml_element(void* userData, const char* name, const char** attributes)
     {
         _3MF_Importer* importer = (_3MF_Importer*)userData;
@@ -1574,9 +1705,10 @@ namespace Slic3r {
         typedef std::map<int, ObjectData> IdToObjectDataMap;
 
         IdToObjectDataMap m_objects_data;
+        mz_uint m_compression_level;
 
     public:
-        bool save_model_to_file(const std::string& filename, Model& model, const DynamicPrintConfig* config);
+        bool save_model_to_file(const std::string& filename, Model& model, const DynamicPrintConfig* config, int compression_level);
 
     private:
         bool _save_model_to_file(const std::string& filename, Model& model, const DynamicPrintConfig* config);
@@ -1592,9 +1724,10 @@ namespace Slic3r {
         bool _add_model_config_file_to_archive(mz_zip_archive& archive, const Model& model);
     };
 
-    bool _3MF_Exporter::save_model_to_file(const std::string& filename, Model& model, const DynamicPrintConfig* config)
+    bool _3MF_Exporter::save_model_to_file(const std::string& filename, Model& model, const DynamicPrintConfig* config, int compression_level)
     {
         clear_errors();
+        m_compression_level = (compression_level < 0) ? (mz_uint)MZ_DEFAULT_LEVEL : std::min((mz_uint)compression_level, (mz_uint)MZ_UBER_COMPRESSION);
         return _save_model_to_file(filename, model, config);
     }
 
@@ -1695,7 +1828,7 @@ namespace Slic3r {
 
         std::string out = stream.str();
 
-        if (!mz_zip_writer_add_mem(&archive, CONTENT_TYPES_FILE.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION))
+        if (!mz_zip_writer_add_mem(&archive, CONTENT_TYPES_FILE.c_str(), (const void*)out.data(), out.length(), m_compression_level))
         {
             add_error("Unable to add content types file to archive");
             return false;
@@ -1714,7 +1847,7 @@ namespace Slic3r {
 
         std::string out = stream.str();
 
-        if (!mz_zip_writer_add_mem(&archive, RELATIONSHIPS_FILE.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION))
+        if (!mz_zip_writer_add_mem(&archive, RELATIONSHIPS_FILE.c_str(), (const void*)out.data(), out.length(), m_compression_level))
         {
             add_error("Unable to add relationships file to archive");
             return false;
@@ -1723,45 +1856,143 @@ namespace Slic3r {
         return true;
     }
 
-    bool _3MF_Exporter::_add_model_file_to_archive(mz_zip_archive& archive, Model& model)
+    // Compresses the text into a raw deflate stream appended to out. The blocks not marked as last are terminated
+    // by a full flush, therefore the independently compressed blocks may be concatenated into a single deflate stream.
+    static bool deflate_block(const std::string& text, mz_uint level, bool last, std::string& out)
     {
-        std::stringstream stream;
-        stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
-        stream << "<" << MODEL_TAG << " unit=\"millimeter\" xml:lang=\"en-US\" xmlns=\"http://schemas.microsoft.com/3dmanufacturing/core/2015/02\" xmlns:slic3rpe=\"http://schemas.slic3r.org/3mf/2017/06\">\n";
-        stream << " <" << METADATA_TAG << " name=\"" << SLIC3RPE_3MF_VERSION << "\">" << VERSION_3MF << "</" << METADATA_TAG << ">\n";
-        stream << " <" << RESOURCES_TAG << ">\n";
+        std::unique_ptr<tdefl_compressor> compressor(new tdefl_compressor);
+        tdefl_put_buf_func_ptr put_buf = [](const void* pBuf, int len, void* pUser) -> mz_bool {
+            ((std::string*)pUser)->append((const char*)pBuf, (size_t)len);
+            return MZ_TRUE;
+        };
+        if (tdefl_init(compressor.get(), put_buf, (void*)&out, (int)tdefl_create_comp_flags_from_zip_params((int)level, -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY)) != TDEFL_STATUS_OKAY)
+            return false;
 
-        BuildItemsList build_items;
+        return tdefl_compress_buffer(compressor.get(), (const void*)text.data(), text.size(), last ? TDEFL_FINISH : TDEFL_FULL_FLUSH) == (last ? TDEFL_STATUS_DONE : TDEFL_STATUS_OKAY);
+    }
 
-        unsigned int object_id = 1;
-        for (ModelObject* obj : model.objects)
-        {
-            if (obj == nullptr)
-                continue;
+    bool _3MF_Exporter::_add_model_file_to_archive(mz_zip_archive& archive, Model& model)
+    {
+        // The model file is compressed piecewise: the header, each object and the build section are formatted
+        // and deflated as independent blocks, the objects in parallel. Only the compressed model file and the text
+        // of the objects being processed are held in memory.
+        std::string compressed;
+        mz_ulong crc = MZ_CRC32_INIT;
+        mz_uint64 size = 0;
+        auto append_block = [&compressed, &crc, &size](const std::string& text, const std::string& deflated) {
+            crc = mz_crc32(crc, (const unsigned char*)text.data(), text.size());
+            size += text.size();
+            compressed += deflated;
+        };
 
-            unsigned int curr_id = object_id;
-            IdToObjectDataMap::iterator object_it = m_objects_data.insert(IdToObjectDataMap::value_type(curr_id, ObjectData(obj))).first;
+        {
+            std::stringstream stream;
+            stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+            stream << "<" << MODEL_TAG << " unit=\"millimeter\" xml:lang=\"en-US\" xmlns=\"http://schemas.microsoft.com/3dmanufacturing/core/2015/02\" xmlns:slic3rpe=\"http://schemas.slic3r.org/3mf/2017/06\">\n";
+            stream << " <" << METADATA_TAG << " name=\"" << SLIC3RPE_3MF_VERSION << "\">" << VERSION_3MF << "</" << METADATA_TAG << ">\n";
+            stream << " <" << RESOURCES_TAG << ">\n";
 
-            if (!_add_object_to_model_stream(stream, object_id, *obj, build_items, object_it->second.volumes_offsets))
+            std::string text = stream.str();
+            std::string deflated;
+            if (!deflate_block(text, m_compression_level, false, deflated))
             {
-                add_error("Unable to add object to archive");
+                add_error("Unable to compress model file");
                 return false;
             }
+            append_block(text, deflated);
         }
 
-        stream << " </" << RESOURCES_TAG << ">\n";
-
-        if (!_add_build_to_model_stream(stream, build_items))
+        struct ObjectBlock
         {
-            add_error("Unable to add build to archive");
+            ModelObject* object;
+            unsigned int object_id;
+            ObjectData* data;
+            BuildItemsList build_items;
+            std::string text;
+            std::string deflated;
+            bool valid;
+        };
+
+        BuildItemsList build_items;
+        bool valid = true;
+
+        unsigned int object_id = 1;
+        size_t idx_object = 0;
+        tbb::parallel_pipeline(4 * tbb::task_scheduler_init::default_num_threads(),
+            tbb::make_filter<void, std::shared_ptr<ObjectBlock>>(tbb::filter::serial_in_order,
+                [this, &model, &object_id, &idx_object](tbb::flow_control& fc) -> std::shared_ptr<ObjectBlock> {
+                    for (; idx_object < model.objects.size() && model.objects[idx_object] == nullptr; ++idx_object);
+                    if (idx_object == model.objects.size())
+                    {
+                        fc.stop();
+                        return nullptr;
+                    }
+                    std::shared_ptr<ObjectBlock> block = std::make_shared<ObjectBlock>();
+                    block->object = model.objects[idx_object++];
+                    block->object_id = object_id;
+                    block->data = &m_objects_data.insert(IdToObjectDataMap::value_type(object_id, ObjectData(block->object))).first->second;
+                    block->valid = true;
+                    // reserves the ids of the object's instances, see _add_object_to_model_stream()
+                    for (const ModelInstance* instance : block->object->instances)
+                    {
+                        if (instance != nullptr)
+                            ++object_id;
+                    }
+                    return block;
+                }) &
+            tbb::make_filter<std::shared_ptr<ObjectBlock>, std::shared_ptr<ObjectBlock>>(tbb::filter::parallel,
+                [this](std::shared_ptr<ObjectBlock> block) -> std::shared_ptr<ObjectBlock> {
+                    std::stringstream stream;
+                    unsigned int object_id = block->object_id;
+                    if (!_add_object_to_model_stream(stream, object_id, *block->object, block->build_items, block->data->volumes_offsets))
+                    {
+                        block->valid = false;
+                        return block;
+                    }
+                    block->text = stream.str();
+                    block->valid = deflate_block(block->text, m_compression_level, false, block->deflated);
+                    return block;
+                }) &
+            tbb::make_filter<std::shared_ptr<ObjectBlock>, void>(tbb::filter::serial_in_order,
+                [this, &build_items, &valid, &append_block](std::shared_ptr<ObjectBlock> block) {
+                    if (!valid)
+                        return;
+                    if (!block->valid)
+                    {
+                        add_error("Unable to add object to archive");
+                        valid = false;
+                        return;
+                    }
+                    append_block(block->text, block->deflated);
+                    build_items.insert(build_items.end(), block->build_items.begin(), block->build_items.end());
+                }));
+
+        if (!valid)
             return false;
-        }
 
-        stream << "</" << MODEL_TAG << ">\n";
+        {
+            std::stringstream stream;
+            stream << " </" << RESOURCES_TAG << ">\n";
 
-        std::string out = stream.str();
+            if (!_add_build_to_model_stream(stream, build_items))
+            {
+                add_error("Unable to add build to archive");
+                return false;
+            }
+
+            stream << "</" << MODEL_TAG << ">\n";
+
+            std::string text = stream.str();
+            std::string deflated;
+            if (!deflate_block(text, m_compression_level, true, deflated))
+            {
+                add_error("Unable to compress model file");
+                return false;
+            }
+            append_block(text, deflated);
+        }
 
-        if (!mz_zip_writer_add_mem(&archive, MODEL_FILE.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION))
+        if (!mz_zip_writer_add_mem_ex(&archive, MODEL_FILE.c_str(), (const void*)compressed.data(), compressed.length(), nullptr, 0, m_compression_level | MZ_ZIP_FLAG_COMPRESSED_DATA, size, (mz_uint32)crc))
         {
             add_error("Unable to add model file to archive");
             return false;
@@ -1942,7 +2173,7 @@ namespace Slic3r {
 
         if (!out.empty())
         {
-            if (!mz_zip_writer_add_mem(&archive, LAYER_HEIGHTS_PROFILE_FILE.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION))
+            if (!mz_zip_writer_add_mem(&archive, LAYER_HEIGHTS_PROFILE_FILE.c_str(), (const void*)out.data(), out.length(), m_compression_level))
             {
                 add_error("Unable to add layer heights profile file to archive");
                 return false;
@@ -1979,7 +2210,7 @@ namespace Slic3r {
 
         if (!out.empty())
         {
-            if (!mz_zip_writer_add_mem(&archive, SLA_SUPPORT_POINTS_FILE.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION))
+            if (!mz_zip_writer_add_mem(&archive, SLA_SUPPORT_POINTS_FILE.c_str(), (const void*)out.data(), out.length(), m_compression_level))
             {
                 add_error("Unable to add sla support points file to archive");
                 return false;
@@ -2000,7 +2231,7 @@ namespace Slic3r {
 
         if (!out.empty())
         {
-            if (!mz_zip_writer_add_mem(&archive, PRINT_CONFIG_FILE.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION))
+            if (!mz_zip_writer_add_mem(&archive, PRINT_CONFIG_FILE.c_str(), (const void*)out.data(), out.length(), m_compression_level))
             {
                 add_error("Unable to add print config file to archive");
                 return false;
@@ -2076,7 +2307,7 @@ namespace Slic3r {
 
         std::string out = stream.str();
 
-        if (!mz_zip_writer_add_mem(&archive, MODEL_CONFIG_FILE.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION))
+        if (!mz_zip_writer_add_mem(&archive, MODEL_CONFIG_FILE.c_str(), (const void*)out.data(), out.length(), m_compression_level))
         {
             add_error("Unable to add model config file to archive");
             return false;
@@ -2096,13 +2327,13 @@ namespace Slic3r {
         return res;
     }
 
-    bool store_3mf(const char* path, Model* model, const DynamicPrintConfig* config)
+    bool store_3mf(const char* path, Model* model, const DynamicPrintConfig* config, int compression_level)
     {
         if ((path == nullptr) || (model == nullptr))
             return false;
 
         _3MF_Exporter exporter;
-        bool res = exporter.save_model_to_file(path, *model, config);
+        bool res = exporter.save_model_to_file(path, *model, config, compression_level);
 
         if (!res)
             exporter.log_errors();
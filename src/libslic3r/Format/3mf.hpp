@@ -11,7 +11,8 @@ namespace Slic3r {
 
     // Save the given model and the config data contained in the given Print into a 3mf file.
     // The model could be modified during the export process if meshes are not repaired or have no shared vertices
-    extern bool store_3mf(const char* path, Model* model, const DynamicPrintConfig* config);
+    // The compression level goes from 0 (no compression) to 10 (best compression), a negative value selects the default level.
+    extern bool store_3mf(const char* path, Model* model, const DynamicPrintConfig* config, int compression_level = -1);
 
 }; // namespace Slic3r
 
@@ -10,6 +10,9 @@
 #include <cstdlib>
 #include <math.h>
 
+#include <tbb/pipeline.h>
+#include <tbb/task_scheduler_init.h>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/find.hpp>
 #include <boost/foreach.hpp>
@@ -443,7 +446,10 @@ void GCode::do_export(Print *print, const char *path, GCodePreviewData *preview_
 
     try {
         m_placeholder_parser_failed_templates.clear();
-        this->_do_export(*print, file);
+        {
+            GCodeOutputStream stream(file);
+            this->_do_export(*print, stream);
+        }
         fflush(file);
         if (ferror(file)) {
             fclose(file);
@@ -473,14 +479,16 @@ void GCode::do_export(Print *print, const char *path, GCodePreviewData *preview_
     }
 
     if (print->config().remaining_times.value) {
-        BOOST_LOG_TRIVIAL(debug) << "Processing remaining times for normal mode";
-        m_normal_time_estimator.post_process_remaining_times(path_tmp, 60.0f);
+        // Insert the remaining times of the normal and of the silent mode in a single pass over the G-code file.
+        // This pass rewrites the file, the M73 lines cannot be emitted while generating the G-code, see post_process_remaining_times().
+        std::vector<GCodeTimeEstimator*> estimators(1, &m_normal_time_estimator);
+        if (m_silent_time_estimator_enabled)
+            estimators.emplace_back(&m_silent_time_estimator);
+        BOOST_LOG_TRIVIAL(debug) << "Processing remaining times" << (m_silent_time_estimator_enabled ? " for normal and silent mode" : " for normal mode");
+        GCodeTimeEstimator::post_process_remaining_times(path_tmp, 60.0f, estimators);
         m_normal_time_estimator.reset();
-        if (m_silent_time_estimator_enabled) {
-            BOOST_LOG_TRIVIAL(debug) << "Processing remaining times for silent mode";
-            m_silent_time_estimator.post_process_remaining_times(path_tmp, 60.0f);
+        if (m_silent_time_estimator_enabled)
             m_silent_time_estimator.reset();
-        }
     }
 
     // starts analyzer calculations
@@ -503,7 +511,7 @@ void GCode::do_export(Print *print, const char *path, GCodePreviewData *preview_
     PROFILE_OUTPUT(debug_out_path("gcode-export-profile.txt").c_str());
 }
 
-void GCode::_do_export(Print &print, FILE *file)
+void GCode::_do_export(Print &print, GCodeOutputStream &file)
 {
     PROFILE_FUNC();
 
@@ -916,13 +924,10 @@ void GCode::_do_export(Print &print, FILE *file)
                 m_cooling_buffer->reset();
                 m_cooling_buffer->set_current_extruder(initial_extruder_id);
                 // Pair the object layers with the support layers by z, extrude them.
-                std::vector<LayerToPrint> layers_to_print = collect_layers_to_print(object);
-                for (const LayerToPrint &ltp : layers_to_print) {
-                    std::vector<LayerToPrint> lrs;
-                    lrs.emplace_back(std::move(ltp));
-                    this->process_layer(file, print, lrs, tool_ordering.tools_for_layer(ltp.print_z()), &copy - object.copies().data());
-                    print.throw_if_canceled();
-                }
+                std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>> layers_to_print;
+                for (const LayerToPrint &ltp : collect_layers_to_print(object))
+                    layers_to_print.emplace_back(ltp.print_z(), std::vector<LayerToPrint>(1, ltp));
+                this->process_layers(file, print, tool_ordering, layers_to_print, &copy - object.copies().data());
 #ifdef HAS_PRESSURE_EQUALIZER
                 if (m_pressure_equalizer)
                     _write(file, m_pressure_equalizer->process("", true));
@@ -974,13 +979,7 @@ void GCode::_do_export(Print &print, FILE *file)
             print.throw_if_canceled();
         }
         // Extrude the layers.
-        for (auto &layer : layers_to_print) {
-            const LayerTools &layer_tools = tool_ordering.tools_for_layer(layer.first);
-            if (m_wipe_tower && layer_tools.has_wipe_tower)
-                m_wipe_tower->next_layer();
-            this->process_layer(file, print, layer.second, layer_tools, size_t(-1));
-            print.throw_if_canceled();
-        }
+        this->process_layers(file, print, tool_ordering, layers_to_print, size_t(-1));
 #ifdef HAS_PRESSURE_EQUALIZER
         if (m_pressure_equalizer)
             _write(file, m_pressure_equalizer->process("", true));
@@ -992,7 +991,7 @@ void GCode::_do_export(Print &print, FILE *file)
 
     // Write end commands to file.
     _write(file, this->retract());
-    _write(file, m_writer.set_fan(false));
+    _write(file, m_cooling_buffer->disable_fan());
 
     if (m_enable_analyzer)
     {
@@ -1141,29 +1140,29 @@ static bool custom_gcode_sets_temperature(const std::string &gcode, const int mc
 
 // Print the machine envelope G-code for the Marlin firmware based on the "machine_max_xxx" parameters.
 // Do not process this piece of G-code by the time estimator, it already knows the values through another sources.
-void GCode::print_machine_envelope(FILE *file, Print &print)
+void GCode::print_machine_envelope(GCodeOutputStream &file, Print &print)
 {
     if (print.config().gcode_flavor.value == gcfMarlin) {
-        fprintf(file, "M201 X%d Y%d Z%d E%d ; sets maximum accelerations, mm/sec^2\n",
+        file.write_format("M201 X%d Y%d Z%d E%d ; sets maximum accelerations, mm/sec^2\n",
             int(print.config().machine_max_acceleration_x.values.front() + 0.5),
             int(print.config().machine_max_acceleration_y.values.front() + 0.5),
             int(print.config().machine_max_acceleration_z.values.front() + 0.5),
             int(print.config().machine_max_acceleration_e.values.front() + 0.5));
-        fprintf(file, "M203 X%d Y%d Z%d E%d ; sets maximum feedrates, mm/sec\n",
+        file.write_format("M203 X%d Y%d Z%d E%d ; sets maximum feedrates, mm/sec\n",
             int(print.config().machine_max_feedrate_x.values.front() + 0.5),
             int(print.config().machine_max_feedrate_y.values.front() + 0.5),
             int(print.config().machine_max_feedrate_z.values.front() + 0.5),
             int(print.config().machine_max_feedrate_e.values.front() + 0.5));
-        fprintf(file, "M204 P%d R%d T%d ; sets acceleration (P, T) and retract acceleration (R), mm/sec^2\n",
+        file.write_format("M204 P%d R%d T%d ; sets acceleration (P, T) and retract acceleration (R), mm/sec^2\n",
             int(print.config().machine_max_acceleration_extruding.values.front() + 0.5),
             int(print.config().machine_max_acceleration_retracting.values.front() + 0.5),
             int(print.config().machine_max_acceleration_extruding.values.front() + 0.5));
-        fprintf(file, "M205 X%.2lf Y%.2lf Z%.2lf E%.2lf ; sets the jerk limits, mm/sec\n",
+        file.write_format("M205 X%.2lf Y%.2lf Z%.2lf E%.2lf ; sets the jerk limits, mm/sec\n",
             print.config().machine_max_jerk_x.values.front(),
             print.config().machine_max_jerk_y.values.front(),
             print.config().machine_max_jerk_z.values.front(),
             print.config().machine_max_jerk_e.values.front());
-        fprintf(file, "M205 S%d T%d ; sets the minimum extruding and travel feed rate, mm/sec\n",
+        file.write_format("M205 S%d T%d ; sets the minimum extruding and travel feed rate, mm/sec\n",
             int(print.config().machine_min_extruding_rate.values.front() + 0.5),
             int(print.config().machine_min_travel_rate.values.front() + 0.5));
     }
@@ -1173,7 +1172,7 @@ void GCode::print_machine_envelope(FILE *file, Print &print)
 // Only do that if the start G-code does not already contain any M-code controlling an extruder temperature.
 // M140 - Set Extruder Temperature
 // M190 - Set Extruder Temperature and Wait
-void GCode::_print_first_layer_bed_temperature(FILE *file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait)
+void GCode::_print_first_layer_bed_temperature(GCodeOutputStream &file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait)
 {
     // Initial bed temperature based on the first extruder.
     int  temp = print.config().first_layer_bed_temperature.get_at(first_printing_extruder_id);
@@ -1193,7 +1192,7 @@ void GCode::_print_first_layer_bed_temperature(FILE *file, Print &print, const s
 // Only do that if the start G-code does not already contain any M-code controlling an extruder temperature.
 // M104 - Set Extruder Temperature
 // M109 - Set Extruder Temperature and Wait
-void GCode::_print_first_layer_extruder_temperatures(FILE *file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait)
+void GCode::_print_first_layer_extruder_temperatures(GCodeOutputStream &file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait)
 {
     // Is the bed temperature set by the provided custom G-code?
     int  temp_by_gcode     = -1;
@@ -1253,9 +1252,7 @@ inline std::vector<GCode::ObjectByExtruder::Island>& object_islands_by_extruder(
 // In non-sequential mode, process_layer is called per each print_z height with all object and support layers accumulated.
 // For multi-material prints, this routine minimizes extruder switches by gathering extruder specific extrusion paths
 // and performing the extruder specific extrusions together.
-void GCode::process_layer(
-    // Write into the output file.
-    FILE                            *file,
+GCode::LayerResult GCode::process_layer(
     const Print                     &print,
     // Set of object & print layers of the same PrintObject and with the same print_z.
     const std::vector<LayerToPrint> &layers,
@@ -1269,9 +1266,10 @@ void GCode::process_layer(
     // Either printing all copies of all objects, or just a single copy of a single object.
     assert(single_object_idx == size_t(-1) || layers.size() == 1);
 
+    LayerResult result;
     if (layer_tools.extruders.empty())
         // Nothing to extrude.
-        return;
+        return result;
 
     // Extract 1st object_layer and support_layer of this set of layers with an equal print_z.
     const Layer         *object_layer  = nullptr;
@@ -1303,10 +1301,10 @@ void GCode::process_layer(
                     break;
                 }
         }
-        m_spiral_vase->enable = enable;
+        m_spiral_vase_enable = enable;
     }
     // If we're going to apply spiralvase to this layer, disable loop clipping
-    m_enable_loop_clipping = ! m_spiral_vase || ! m_spiral_vase->enable;
+    m_enable_loop_clipping = ! m_spiral_vase || ! m_spiral_vase_enable;
     
     std::string gcode;
 
@@ -1543,7 +1541,6 @@ void GCode::process_layer(
     } // for objects
 
     // Extrude the skirt, brim, support, perimeters, infill ordered by the extruders.
-    std::vector<std::unique_ptr<EdgeGrid::Grid>> lower_layer_edge_grids(layers.size());
     for (unsigned int extruder_id : layer_tools.extruders)
     {
         gcode += (layer_tools.has_wipe_tower && m_wipe_tower) ?
@@ -1643,9 +1640,9 @@ void GCode::process_layer(
 
                         if (print.config().infill_first) {
                             gcode += this->extrude_infill(print, by_region_specific);
-                            gcode += this->extrude_perimeters(print, by_region_specific, lower_layer_edge_grids[layer_id]);
+                            gcode += this->extrude_perimeters(print, by_region_specific);
                         } else {
-                            gcode += this->extrude_perimeters(print, by_region_specific, lower_layer_edge_grids[layer_id]);
+                            gcode += this->extrude_perimeters(print, by_region_specific);
                             gcode += this->extrude_infill(print,by_region_specific);
                         }
                     }
@@ -1657,32 +1654,138 @@ void GCode::process_layer(
         }
     }
 
-    // Apply spiral vase post-processing if this layer contains suitable geometry
-    // (we must feed all the G-code into the post-processor, including the first 
-    // bottom non-spiral layers otherwise it will mess with positions)
-    // we apply spiral vase at this stage because it requires a full layer.
-    // Just a reminder: A spiral vase mode is allowed for a single object per layer, single material print only.
-    if (m_spiral_vase)
-        gcode = m_spiral_vase->process_layer(gcode);
+    result.gcode              = std::move(gcode);
+    result.layer_id           = layer.id();
+    result.spiral_vase_enable = m_spiral_vase_enable;
+    return result;
+}
 
-    // Apply cooling logic; this may alter speeds.
-    if (m_cooling_buffer)
-        gcode = m_cooling_buffer->process_layer(gcode, layer.id());
+// The G-code of a layer depends on the state left by the previous layer (the last position, the extruder,
+// its retraction and E axis state), therefore process_layer() has to be called for the layers in order.
+// The layers are pushed through a pipeline: The distance fields of the lower layers for the seam placement
+// are calculated in parallel ahead of process_layer(), while the spiral vase, cooling and the output of the
+// previous layers (including the G-code analyzer and the time estimators) run concurrently with the generation
+// of the next layers. All the stages with a state are serial and in order, therefore the resulting G-code
+// is the same as if the layers were processed one after the other.
+// The CoolingBuffer works with its own copies of the print config, of the extruder IDs and of the fan state, therefore
+// it does not share any state with the generation stage, which modifies the object and region config and m_writer.
+void GCode::process_layers(
+    // Write into the output file.
+    GCodeOutputStream                                                 &file,
+    const Print                                                       &print,
+    const ToolOrdering                                                &tool_ordering,
+    const std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>> &layers_to_print,
+    // If set to size_t(-1), then print all copies of all objects.
+    // Otherwise print a single copy of a single object.
+    const size_t                                                       single_object_idx)
+{
+    struct LayerToProcess {
+        size_t      idx;
+        LayerResult result;
+    };
+    typedef std::shared_ptr<LayerToProcess> LayerToProcessPtr;
+
+    // Release the distance fields of the layers below the object layers of a print layer.
+    auto clear_lower_layer_edge_grids = [](const std::vector<LayerToPrint> &layers) {
+        for (const LayerToPrint &ltp : layers)
+            if (ltp.object_layer != nullptr && ltp.object_layer->lower_layer != nullptr)
+                ltp.object_layer->lower_layer->clear_slices_edge_grid();
+    };
+
+    size_t next_layer_idx = 0;
+    // Layers in flight, limits the memory held by the distance fields and by the G-code waiting for the post-processing.
+    const size_t max_tokens = 4 * size_t(std::max(1, tbb::task_scheduler_init::default_num_threads()));
+    try {
+        tbb::parallel_pipeline(max_tokens,
+            tbb::make_filter<void, LayerToProcessPtr>(tbb::filter::serial_in_order,
+                [&layers_to_print, &next_layer_idx](tbb::flow_control &fc) -> LayerToProcessPtr {
+                    if (next_layer_idx == layers_to_print.size()) {
+                        fc.stop();
+                        return LayerToProcessPtr();
+                    }
+                    LayerToProcessPtr layer = std::make_shared<LayerToProcess>();
+                    layer->idx = next_layer_idx ++;
+                    return layer;
+                }) &
+            // Calculate the distance fields of the layers below the object layers with perimeters.
+            tbb::make_filter<LayerToProcessPtr, LayerToProcessPtr>(tbb::filter::parallel,
+                [&print, &layers_to_print](LayerToProcessPtr layer) -> LayerToProcessPtr {
+                    for (const LayerToPrint &layer_to_print : layers_to_print[layer->idx].second) {
+                        const Layer *object_layer = layer_to_print.object_layer;
+                        if (object_layer == nullptr || object_layer->lower_layer == nullptr)
+                            continue;
+                        bool has_perimeters = false;
+                        for (const LayerRegion *layerm : object_layer->regions())
+                            if (! layerm->perimeters.entities.empty()) {
+                                has_perimeters = true;
+                                break;
+                            }
+                        if (has_perimeters) {
+                            print.throw_if_canceled();
+                            object_layer->lower_layer->slices_edge_grid();
+                        }
+                    }
+                    return layer;
+                }) &
+            tbb::make_filter<LayerToProcessPtr, LayerToProcessPtr>(tbb::filter::serial_in_order,
+                [this, &print, &tool_ordering, &layers_to_print, single_object_idx, &clear_lower_layer_edge_grids](LayerToProcessPtr layer) -> LayerToProcessPtr {
+                    const std::pair<coordf_t, std::vector<LayerToPrint>> &layer_to_print = layers_to_print[layer->idx];
+                    const LayerTools &layer_tools = tool_ordering.tools_for_layer(layer_to_print.first);
+                    if (m_wipe_tower && layer_tools.has_wipe_tower)
+                        m_wipe_tower->next_layer();
+                    layer->result = this->process_layer(print, layer_to_print.second, layer_tools, single_object_idx);
+                    // Release the distance fields early.
+                    clear_lower_layer_edge_grids(layer_to_print.second);
+                    print.throw_if_canceled();
+                    return layer;
+                }) &
+            tbb::make_filter<LayerToProcessPtr, LayerToProcessPtr>(tbb::filter::serial_in_order,
+                [this](LayerToProcessPtr layer) -> LayerToProcessPtr {
+                    LayerResult &result = layer->result;
+                    if (result.layer_id == size_t(-1))
+                        return layer;
+                    // Apply spiral vase post-processing if this layer contains suitable geometry
+                    // (we must feed all the G-code into the post-processor, including the first 
+                    // bottom non-spiral layers otherwise it will mess with positions)
+                    // we apply spiral vase at this stage because it requires a full layer.
+                    // Just a reminder: A spiral vase mode is allowed for a single object per layer, single material print only.
+                    if (m_spiral_vase) {
+                        m_spiral_vase->enable = result.spiral_vase_enable;
+                        result.gcode = m_spiral_vase->process_layer(result.gcode);
+                    }
+
+                    // Apply cooling logic; this may alter speeds.
+                    if (m_cooling_buffer)
+                        result.gcode = m_cooling_buffer->process_layer(result.gcode, result.layer_id);
 
 #ifdef HAS_PRESSURE_EQUALIZER
-    // Apply pressure equalization if enabled;
-    // printf("G-code before filter:\n%s\n", gcode.c_str());
-    if (m_pressure_equalizer)
-        gcode = m_pressure_equalizer->process(gcode.c_str(), false);
-    // printf("G-code after filter:\n%s\n", out.c_str());
+                    // Apply pressure equalization if enabled;
+                    // printf("G-code before filter:\n%s\n", gcode.c_str());
+                    if (m_pressure_equalizer)
+                        result.gcode = m_pressure_equalizer->process(result.gcode.c_str(), false);
+                    // printf("G-code after filter:\n%s\n", out.c_str());
 #endif /* HAS_PRESSURE_EQUALIZER */
-    
-    _write(file, gcode);
-    BOOST_LOG_TRIVIAL(trace) << "Exported layer " << layer.id() << " print_z " << print_z << 
-        ", time estimator memory: " <<
-            format_memsize_MB(m_normal_time_estimator.memory_used() + m_silent_time_estimator_enabled ? m_silent_time_estimator.memory_used() : 0) <<
-        ", analyzer memory: " <<
-            format_memsize_MB(m_analyzer.memory_used());
+                    return layer;
+                }) &
+            tbb::make_filter<LayerToProcessPtr, void>(tbb::filter::serial_in_order,
+                [this, &file, &layers_to_print](LayerToProcessPtr layer) {
+                    const LayerResult &result = layer->result;
+                    if (result.layer_id == size_t(-1))
+                        return;
+                    _write(file, result.gcode);
+                    BOOST_LOG_TRIVIAL(trace) << "Exported layer " << result.layer_id << " print_z " << layers_to_print[layer->idx].first << 
+                        ", time estimator memory: " <<
+                            format_memsize_MB(m_normal_time_estimator.memory_used() + m_silent_time_estimator_enabled ? m_silent_time_estimator.memory_used() : 0) <<
+                        ", analyzer memory: " <<
+                            format_memsize_MB(m_analyzer.memory_used());
+                }));
+    } catch (...) {
+        // Canceled or failed: The distance fields of the layers in flight may have been calculated already,
+        // don't leave them cached in the Layers.
+        for (size_t i = 0; i < next_layer_idx; ++ i)
+            clear_lower_layer_edge_grids(layers_to_print[i].second);
+        throw;
+    }
 }
 
 void GCode::apply_print_config(const PrintConfig &print_config)
@@ -1971,31 +2074,22 @@ std::vector<float> polygon_angles_at_vertices(const Polygon &polygon, const std:
     return angles;
 }
 
-std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, double speed, std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid)
+std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, double speed, const EdgeGrid::Grid *lower_layer_edge_grid)
 {
     // get a copy; don't modify the orientation of the original loop object otherwise
     // next copies (if any) would not detect the correct orientation
 
-    if (m_layer->lower_layer != nullptr && lower_layer_edge_grid != nullptr) {
-        if (! *lower_layer_edge_grid) {
-            // Create the distance field for a layer below.
-            const coord_t distance_field_resolution = coord_t(scale_(1.) + 0.5);
-            *lower_layer_edge_grid = make_unique<EdgeGrid::Grid>();
-            (*lower_layer_edge_grid)->create(m_layer->lower_layer->slices, distance_field_resolution);
-            (*lower_layer_edge_grid)->calculate_sdf();
-            #if 0
-            {
-                static int iRun = 0;
-                BoundingBox bbox = (*lower_layer_edge_grid)->bbox();
-                bbox.min(0) -= scale_(5.f);
-                bbox.min(1) -= scale_(5.f);
-                bbox.max(0) += scale_(5.f);
-                bbox.max(1) += scale_(5.f);
-                EdgeGrid::save_png(*(*lower_layer_edge_grid), bbox, scale_(0.1f), debug_out_path("GCode_extrude_loop_edge_grid-%d.png", iRun++));
-            }
-            #endif
-        }
+    #if 0
+    if (lower_layer_edge_grid != nullptr) {
+        static int iRun = 0;
+        BoundingBox bbox = lower_layer_edge_grid->bbox();
+        bbox.min(0) -= scale_(5.f);
+        bbox.min(1) -= scale_(5.f);
+        bbox.max(0) += scale_(5.f);
+        bbox.max(1) += scale_(5.f);
+        EdgeGrid::save_png(*lower_layer_edge_grid, bbox, scale_(0.1f), debug_out_path("GCode_extrude_loop_edge_grid-%d.png", iRun++));
     }
+    #endif
   
     // extrude all loops ccw
     bool was_clockwise = loop.make_counter_clockwise();
@@ -2082,22 +2176,20 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
         }
 
         // Penalty for overhangs.
-        if (lower_layer_edge_grid && (*lower_layer_edge_grid)) {
+        if (lower_layer_edge_grid != nullptr) {
             // Use the edge grid distance field structure over the lower layer to calculate overhangs.
             coord_t nozzle_r = coord_t(floor(scale_(0.5 * nozzle_dmr) + 0.5));
             coord_t search_r = coord_t(floor(scale_(0.8 * nozzle_dmr) + 0.5));
-            for (size_t i = 0; i < polygon.points.size(); ++ i) {
-                const Point &p = polygon.points[i];
-                coordf_t dist;
-                // Signed distance is positive outside the object, negative inside the object.
-                // The point is considered at an overhang, if it is more than nozzle radius
-                // outside of the lower layer contour.
-                bool found = (*lower_layer_edge_grid)->signed_distance(p, search_r, dist);
-                // If the approximate Signed Distance Field was initialized over lower_layer_edge_grid,
-                // then the signed distnace shall always be known.
-                assert(found);
-                penalties[i] += extrudate_overlap_penalty(float(nozzle_r), penaltyOverhangHalf, float(dist));
-            }
+            // Signed distance is positive outside the object, negative inside the object.
+            // The point is considered at an overhang, if it is more than nozzle radius
+            // outside of the lower layer contour.
+            std::vector<coordf_t> dists;
+            bool found = lower_layer_edge_grid->signed_distance_each(polygon.points, search_r, dists);
+            // If the approximate Signed Distance Field was initialized over lower_layer_edge_grid,
+            // then the signed distnace shall always be known.
+            assert(found);
+            for (size_t i = 0; i < polygon.points.size(); ++ i)
+                penalties[i] += extrudate_overlap_penalty(float(nozzle_r), penaltyOverhangHalf, float(dists[i]));
         }
 
         // Find a point with a minimum penalty.
@@ -2253,7 +2345,7 @@ std::string GCode::extrude_multi_path(ExtrusionMultiPath multipath, std::string
     return gcode;
 }
 
-std::string GCode::extrude_entity(const ExtrusionEntity &entity, std::string description, double speed, std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid)
+std::string GCode::extrude_entity(const ExtrusionEntity &entity, std::string description, double speed, const EdgeGrid::Grid *lower_layer_edge_grid)
 {
     if (const ExtrusionPath* path = dynamic_cast<const ExtrusionPath*>(&entity))
         return this->extrude_path(*path, description, speed);
@@ -2282,13 +2374,19 @@ std::string GCode::extrude_path(ExtrusionPath path, std::string description, dou
 }
 
 // Extrude perimeters: Decide where to put seams (hide or align seams).
-std::string GCode::extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::unique_ptr<EdgeGrid::Grid> &lower_layer_edge_grid)
+std::string GCode::extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region)
 {
     std::string gcode;
+    // Distance field of the layer below for the seam placement, shared by all the copies and regions,
+    // precalculated by process_layers() or calculated on demand.
+    const EdgeGrid::Grid *lower_layer_edge_grid = nullptr;
     for (const ObjectByExtruder::Island::Region &region : by_region) {
         m_config.apply(print.regions()[&region - &by_region.front()]->config());
-        for (ExtrusionEntity *ee : region.perimeters.entities)
-            gcode += this->extrude_entity(*ee, "perimeter", -1., &lower_layer_edge_grid);
+        for (ExtrusionEntity *ee : region.perimeters.entities) {
+            if (lower_layer_edge_grid == nullptr && m_layer->lower_layer != nullptr)
+                lower_layer_edge_grid = &m_layer->lower_layer->slices_edge_grid();
+            gcode += this->extrude_entity(*ee, "perimeter", -1., lower_layer_edge_grid);
+        }
     }
     return gcode;
 }
@@ -2340,59 +2438,100 @@ std::string GCode::extrude_support(const ExtrusionEntityCollection &support_fill
     return gcode;
 }
 
-void GCode::_write(FILE* file, const char *what)
+void GCode::_write(GCodeOutputStream &file, const char *what, size_t len)
 {
-    if (what != nullptr) {
+    // The G-code is tokenized just once, the parsed lines are passed to the analyzer and to the time estimators.
+    GCodeReader::GCodeLine gline;
+    auto action = [this, &file](GCodeReader&, const GCodeReader::GCodeLine &line) {
         // apply analyzer, if enabled
-        const char* gcode = m_enable_analyzer ? m_analyzer.process_gcode(what).c_str() : what;
-
-        // writes string to file
-        fwrite(gcode, 1, ::strlen(gcode), file);
+        if (m_enable_analyzer) {
+            if (! m_analyzer.process_gcode_line(line))
+                // The analyzer workcodes are removed from the G-code, the time estimators do not see them.
+                return;
+            // writes the line to file
+            file.write(line.raw());
+            file.write("\n", 1);
+        }
         // updates time estimator and gcode lines vector
-        m_normal_time_estimator.add_gcode_block(gcode);
+        m_normal_time_estimator.add_gcode_line(line);
         if (m_silent_time_estimator_enabled)
-            m_silent_time_estimator.add_gcode_block(gcode);
+            m_silent_time_estimator.add_gcode_line(line);
+    };
+    for (const char *ptr = what; *ptr != 0;) {
+        gline.reset();
+        ptr = m_write_parser.parse_line(ptr, gline, action);
     }
+
+    if (! m_enable_analyzer)
+        // writes string to file
+        file.write(what, len);
 }
 
-void GCode::_writeln(FILE* file, const std::string &what)
+void GCode::_writeln(GCodeOutputStream &file, const std::string &what)
 {
     if (! what.empty())
         _write(file, (what.back() == '\n') ? what : (what + '\n'));
 }
 
-void GCode::_write_format(FILE* file, const char* format, ...)
+void GCode::_write_format(GCodeOutputStream &file, const char* format, ...)
 {
     va_list args;
     va_start(args, format);
 
-    int buflen;
-    {
-        va_list args2;
-        va_copy(args2, args);
-        buflen =
-    #ifdef _MSC_VER
-            ::_vscprintf(format, args2)
-    #else
-            ::vsnprintf(nullptr, 0, format, args2)
-    #endif
-            + 1;
-        va_end(args2);
-    }
-
+    // Most of the formatted lines fit into the stack buffer, format them just once.
     char buffer[1024];
-    bool buffer_dynamic = buflen > 1024;
-    char *bufptr = buffer_dynamic ? (char*)malloc(buflen) : buffer;
-    int res = ::vsnprintf(bufptr, buflen, format, args);
-    if (res > 0)
-        _write(file, bufptr);
+    va_list args2;
+    va_copy(args2, args);
+    int res = ::vsnprintf(buffer, sizeof(buffer), format, args2);
+    va_end(args2);
+    if (res >= int(sizeof(buffer))) {
+        std::vector<char> buffer_dynamic(res + 1);
+        res = ::vsnprintf(buffer_dynamic.data(), buffer_dynamic.size(), format, args);
+        if (res > 0)
+            _write(file, buffer_dynamic.data(), size_t(res));
+    } else if (res > 0)
+        _write(file, buffer, size_t(res));
+
+    va_end(args);
+}
+
+void GCodeOutputStream::write_format(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
 
-    if (buffer_dynamic)
-        free(bufptr);
+    va_list args2;
+    va_copy(args2, args);
+    int res = ::vsnprintf(m_buffer.data() + m_used, m_buffer.size() - m_used, format, args2);
+    va_end(args2);
+    if (res >= 0 && size_t(res) >= m_buffer.size() - m_used) {
+        // Did not fit into the rest of the buffer.
+        this->flush();
+        if (size_t(res) < m_buffer.size())
+            res = ::vsnprintf(m_buffer.data(), m_buffer.size(), format, args);
+        else {
+            std::vector<char> buffer_dynamic(res + 1);
+            ::vsnprintf(buffer_dynamic.data(), buffer_dynamic.size(), format, args);
+            ::fwrite(buffer_dynamic.data(), 1, res, m_file);
+            m_flushed += res;
+            res = 0;
+        }
+    }
+    if (res > 0)
+        m_used += res;
 
     va_end(args);
 }
 
+void GCodeOutputStream::flush()
+{
+    if (m_used > 0) {
+        ::fwrite(m_buffer.data(), 1, m_used, m_file);
+        m_flushed += m_used;
+        m_used = 0;
+    }
+}
+
 std::string GCode::_extrude(const ExtrusionPath &path, std::string description, double speed)
 {
     std::string gcode;
@@ -2535,14 +2674,14 @@ std::string GCode::_extrude(const ExtrusionPath &path, std::string description,
     }
 
     // F is mm per minute.
-    gcode += m_writer.set_speed(F, "", comment);
+    m_writer.set_speed(gcode, F, "", comment);
     double path_length = 0.;
     {
         std::string comment = m_config.gcode_comments ? description : "";
         for (const Line &line : path.polyline.lines()) {
             const double line_length = line.length() * SCALING_FACTOR;
             path_length += line_length;
-            gcode += m_writer.extrude_to_xy(
+            m_writer.extrude_to_xy(gcode,
                 this->point_to_gcode(line.b),
                 e_per_mm * line_length,
                 comment);
@@ -2596,7 +2735,7 @@ std::string GCode::travel_to(const Point &point, ExtrusionRole role, std::string
     Lines lines = travel.lines();
     if (! lines.empty()) {
         for (const Line &line : lines)
-    	    gcode += m_writer.travel_to_xy(this->point_to_gcode(line.b), comment);    
+    	    m_writer.travel_to_xy(gcode, this->point_to_gcode(line.b), comment);
         this->set_last_pos(lines.back().b);
     }
     return gcode;
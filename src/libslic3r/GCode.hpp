@@ -18,8 +18,11 @@
 #include "EdgeGrid.hpp"
 #include "GCode/Analyzer.hpp"
 
+#include <cstdio>
+#include <cstring>
 #include <memory>
 #include <string>
+#include <vector>
 
 #ifdef HAS_PRESSURE_EQUALIZER
 #include "GCode/PressureEqualizer.hpp"
@@ -46,7 +49,8 @@ public:
     ~AvoidCrossingPerimeters() {}
 
     void init_external_mp(const ExPolygons &islands) { m_external_mp = Slic3r::make_unique<MotionPlanner>(islands); }
-    void init_layer_mp(const ExPolygons &islands) { m_layer_mp = Slic3r::make_unique<MotionPlanner>(islands); }
+    // Reuse the visibility graphs of the islands, which did not change since the previous layer.
+    void init_layer_mp(const ExPolygons &islands) { m_layer_mp = Slic3r::make_unique<MotionPlanner>(islands, m_layer_mp.get()); }
 
     Polyline travel_to(const GCode &gcodegen, const Point &point);
 
@@ -126,6 +130,41 @@ private:
     bool                                                         i_have_brim = false;
 };
 
+// Buffered sink of the exported G-code.
+// The G-code blocks are appended into a reusable buffer, which is written into the file in large chunks.
+class GCodeOutputStream {
+public:
+    GCodeOutputStream(FILE *file, size_t buffer_size = 1024 * 1024) : m_file(file), m_buffer(buffer_size), m_used(0), m_flushed(0) {}
+    ~GCodeOutputStream() { this->flush(); }
+
+    void write(const char *data, size_t len) {
+        if (m_used + len > m_buffer.size()) {
+            this->flush();
+            if (len >= m_buffer.size()) {
+                // Longer than the buffer, pass it to the file directly.
+                ::fwrite(data, 1, len, m_file);
+                m_flushed += len;
+                return;
+            }
+        }
+        memcpy(m_buffer.data() + m_used, data, len);
+        m_used += len;
+    }
+    void write(const std::string &str) { this->write(str.data(), str.size()); }
+    // Format directly into the buffer. The output is not passed to the G-code analyzer or to the time estimators.
+    void write_format(const char *format, ...);
+    // Write the buffered G-code into the file.
+    void flush();
+    // Number of bytes written into the file or buffered so far.
+    size_t size() const { return m_flushed + m_used; }
+
+private:
+    FILE                *m_file;
+    std::vector<char>    m_buffer;
+    size_t               m_used;
+    size_t               m_flushed;
+};
+
 class GCode {
 public:        
     GCode() : 
@@ -144,6 +183,7 @@ public:
         m_last_mm3_per_mm(GCodeAnalyzer::Default_mm3_per_mm),
         m_last_width(GCodeAnalyzer::Default_Width),
         m_last_height(GCodeAnalyzer::Default_Height),
+        m_spiral_vase_enable(false),
         m_brim_done(false),
         m_second_layer_things_done(false),
         m_normal_time_estimator(GCodeTimeEstimator::Normal),
@@ -183,7 +223,7 @@ public:
     static void append_full_config(const Print& print, std::string& str);
 
 protected:
-    void            _do_export(Print &print, FILE *file);
+    void            _do_export(Print &print, GCodeOutputStream &file);
 
     // Object and support extrusions of the same PrintObject at the same print_z.
     struct LayerToPrint
@@ -197,9 +237,17 @@ protected:
     };
     static std::vector<GCode::LayerToPrint>                            collect_layers_to_print(const PrintObject &object);
     static std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>> collect_layers_to_print(const Print &print);
-    void            process_layer(
-        // Write into the output file.
-        FILE                            *file,
+    // G-code of a single layer produced by process_layer(), before the spiral vase, cooling and pressure equalizer post-processing.
+    struct LayerResult
+    {
+        LayerResult() : layer_id(size_t(-1)), spiral_vase_enable(false) {}
+        std::string gcode;
+        // Layer id to be passed to the CoolingBuffer. If size_t(-1), there is nothing to post-process and to write.
+        size_t      layer_id;
+        // Value of SpiralVase::enable for this layer.
+        bool        spiral_vase_enable;
+    };
+    LayerResult     process_layer(
         const Print                     &print,
         // Set of object & print layers of the same PrintObject and with the same print_z.
         const std::vector<LayerToPrint> &layers,
@@ -207,14 +255,24 @@ protected:
         // If set to size_t(-1), then print all copies of all objects.
         // Otherwise print a single copy of a single object.
         const size_t                     single_object_idx = size_t(-1));
+    // Generate, post-process and write G-code of the layers in a pipeline.
+    void            process_layers(
+        // Write into the output file.
+        GCodeOutputStream                                                 &file,
+        const Print                                                       &print,
+        const ToolOrdering                                                &tool_ordering,
+        const std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>> &layers_to_print,
+        // If set to size_t(-1), then print all copies of all objects.
+        // Otherwise print a single copy of a single object.
+        const size_t                                                       single_object_idx = size_t(-1));
 
     void            set_last_pos(const Point &pos) { m_last_pos = pos; m_last_pos_defined = true; }
     bool            last_pos_defined() const { return m_last_pos_defined; }
     void            set_extruders(const std::vector<unsigned int> &extruder_ids);
     std::string     preamble();
     std::string     change_layer(coordf_t print_z);
-    std::string     extrude_entity(const ExtrusionEntity &entity, std::string description = "", double speed = -1., std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid = nullptr);
-    std::string     extrude_loop(ExtrusionLoop loop, std::string description, double speed = -1., std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid = nullptr);
+    std::string     extrude_entity(const ExtrusionEntity &entity, std::string description = "", double speed = -1., const EdgeGrid::Grid *lower_layer_edge_grid = nullptr);
+    std::string     extrude_loop(ExtrusionLoop loop, std::string description, double speed = -1., const EdgeGrid::Grid *lower_layer_edge_grid = nullptr);
     std::string     extrude_multi_path(ExtrusionMultiPath multipath, std::string description = "", double speed = -1.);
     std::string     extrude_path(ExtrusionPath path, std::string description = "", double speed = -1.);
 
@@ -252,7 +310,7 @@ protected:
     };
 
 
-    std::string     extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::unique_ptr<EdgeGrid::Grid> &lower_layer_edge_grid);
+    std::string     extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region);
     std::string     extrude_infill(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region);
     std::string     extrude_support(const ExtrusionEntityCollection &support_fills);
 
@@ -309,6 +367,9 @@ protected:
 
     std::unique_ptr<CoolingBuffer>      m_cooling_buffer;
     std::unique_ptr<SpiralVase>         m_spiral_vase;
+    // Spiral vase enabled for the last layer generated. SpiralVase::enable is set from LayerResult
+    // by the post-processing stage, which may lag behind the G-code generation.
+    bool                                m_spiral_vase_enable;
 #ifdef HAS_PRESSURE_EQUALIZER
     std::unique_ptr<PressureEqualizer>  m_pressure_equalizer;
 #endif /* HAS_PRESSURE_EQUALIZER */
@@ -334,22 +395,28 @@ protected:
     // Analyzer
     GCodeAnalyzer m_analyzer;
 
+    // Parser of the G-code passed to _write(), its parsed lines are shared by the analyzer and the time estimators.
+    GCodeReader m_write_parser;
+
     // Write a string into a file.
-    void _write(FILE* file, const std::string& what) { this->_write(file, what.c_str()); }
-    void _write(FILE* file, const char *what);
+    // The G-code is passed to the analyzer and to the time estimators as well.
+    void _write(GCodeOutputStream &file, const std::string& what) { this->_write(file, what.c_str(), what.size()); }
+    void _write(GCodeOutputStream &file, const char *what) { if (what != nullptr) this->_write(file, what, ::strlen(what)); }
+    // Write a zero terminated string of a known length into a file.
+    void _write(GCodeOutputStream &file, const char *what, size_t len);
 
     // Write a string into a file. 
     // Add a newline, if the string does not end with a newline already.
     // Used to export a custom G-code section processed by the PlaceholderParser.
-    void _writeln(FILE* file, const std::string& what);
+    void _writeln(GCodeOutputStream &file, const std::string& what);
 
     // Formats and write into a file the given data. 
-    void _write_format(FILE* file, const char* format, ...);
+    void _write_format(GCodeOutputStream &file, const char* format, ...);
 
     std::string _extrude(const ExtrusionPath &path, std::string description = "", double speed = -1);
-    void print_machine_envelope(FILE *file, Print &print);
-    void _print_first_layer_bed_temperature(FILE *file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait);
-    void _print_first_layer_extruder_temperatures(FILE *file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait);
+    void print_machine_envelope(GCodeOutputStream &file, Print &print);
+    void _print_first_layer_bed_temperature(GCodeOutputStream &file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait);
+    void _print_first_layer_extruder_temperatures(GCodeOutputStream &file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait);
     // this flag triggers first layer speeds
     bool                                on_first_layer() const { return m_layer != nullptr && m_layer->id() == 0; }
 
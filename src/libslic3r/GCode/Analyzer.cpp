@@ -120,13 +120,23 @@ void GCodeAnalyzer::reset()
     m_moves_map.clear();
 }
 
-const std::string& GCodeAnalyzer::process_gcode(const std::string& gcode)
+const std::string& GCodeAnalyzer::process_gcode(const char *gcode)
 {
-    m_process_output = "";
+    // Keep the capacity of the output buffer to avoid reallocations for every block.
+    m_process_output.clear();
 
-    m_parser.parse_buffer(gcode,
-        [this](GCodeReader& reader, const GCodeReader::GCodeLine& line)
-    { this->_process_gcode_line(reader, line); });
+    GCodeReader::GCodeLine gline;
+    auto action = [this](GCodeReader&, const GCodeReader::GCodeLine& line) {
+        if (this->process_gcode_line(line)) {
+            // puts the line back into the gcode
+            m_process_output += line.raw();
+            m_process_output += '\n';
+        }
+    };
+    for (const char *ptr = gcode; *ptr != 0;) {
+        gline.reset();
+        ptr = m_parser.parse_line(ptr, gline, action);
+    }
 
     return m_process_output;
 }
@@ -154,16 +164,16 @@ bool GCodeAnalyzer::is_valid_extrusion_role(ExtrusionRole role)
     return ((erPerimeter <= role) && (role < erMixed));
 }
 
-void GCodeAnalyzer::_process_gcode_line(GCodeReader&, const GCodeReader::GCodeLine& line)
+bool GCodeAnalyzer::process_gcode_line(const GCodeReader::GCodeLine& line)
 {
     // processes 'special' comments contained in line
     if (_process_tags(line))
     {
 #if 0
         // DEBUG ONLY: puts the line back into the gcode
-        m_process_output += line.raw() + "\n";
+        return true;
 #endif
-        return;
+        return false;
     }
 
     // sets new start position/extrusion
@@ -255,8 +265,7 @@ void GCodeAnalyzer::_process_gcode_line(GCodeReader&, const GCodeReader::GCodeLi
         }
     }
 
-    // puts the line back into the gcode
-    m_process_output += line.raw() + "\n";
+    return true;
 }
 
 // Returns the new absolute position on the given axis in dependence of the given parameters
@@ -115,7 +115,12 @@ public:
     void reset();
 
     // Adds the gcode contained in the given string to the analysis and returns it after removing the workcodes
-    const std::string& process_gcode(const std::string& gcode);
+    const std::string& process_gcode(const std::string& gcode) { return this->process_gcode(gcode.c_str()); }
+    const std::string& process_gcode(const char *gcode);
+
+    // Adds the given gcode line, already parsed by a GCodeReader, to the analysis.
+    // Returns false if the line is a workcode, which is to be removed from the gcode.
+    bool process_gcode_line(const GCodeReader::GCodeLine& line);
 
     // Calculates all data needed for gcode visualization
     void calc_gcode_preview_data(GCodePreviewData& preview_data);
@@ -126,9 +131,6 @@ public:
     static bool is_valid_extrusion_role(ExtrusionRole role);
 
 private:
-    // Processes the given gcode line
-    void _process_gcode_line(GCodeReader& reader, const GCodeReader::GCodeLine& line);
-
     // Move
     void _processG1(const GCodeReader::GCodeLine& line);
 
@@ -2,6 +2,8 @@
 #define slic3r_CoolingBuffer_hpp_
 
 #include "libslic3r.h"
+#include "../GCodeWriter.hpp"
+#include "../PrintConfig.hpp"
 #include <map>
 #include <string>
 
@@ -26,6 +28,8 @@ public:
     void        reset();
     void        set_current_extruder(unsigned int extruder_id) { m_current_extruder = extruder_id; }
     std::string process_layer(const std::string &gcode, size_t layer_id);
+    // Turn the fan off at the end of the print.
+    std::string disable_fan() { return m_writer.set_fan(0); }
     GCode* 	    gcodegen() { return &m_gcodegen; }
 
 private:
@@ -37,6 +41,10 @@ private:
     std::string apply_layer_cooldown(const std::string &gcode, size_t layer_id, float layer_time, std::vector<PerExtruderAdjustments> &per_extruder_adjustments);
 
     GCode&              m_gcodegen;
+    // The layers are cooled concurrently with the G-code generation of the next layers, see GCode::process_layers().
+    // Therefore the print config, the extruder IDs and the fan state are not taken from m_gcodegen, but from these copies.
+    PrintConfig         m_config;
+    GCodeWriter         m_writer;
     std::string         m_gcode;
     // Internal data.
     // X,Y,Z,E,F
@@ -258,6 +258,13 @@ namespace Slic3r {
 
     bool GCodeTimeEstimator::post_process_remaining_times(const std::string& filename, float interval)
     {
+        return post_process_remaining_times(filename, interval, { this });
+    }
+
+    bool GCodeTimeEstimator::post_process_remaining_times(const std::string& filename, float interval, const std::vector<GCodeTimeEstimator*>& estimators)
+    {
+        assert(! estimators.empty());
+
         boost::nowide::ifstream in(filename);
         if (!in.good())
             throw std::runtime_error(std::string("Remaining times export failed.\nCannot open file for reading.\n"));
@@ -268,30 +275,34 @@ namespace Slic3r {
         if (out == nullptr)
             throw std::runtime_error(std::string("Remaining times export failed.\nCannot open file for writing.\n"));
 
-        std::string time_mask;
-        switch (_mode)
-        {
-        default:
-        case Normal:
+        // State of the M73 output of a single estimator.
+        struct RemainingTimes
         {
-            time_mask = "M73 P%s R%s\n";
-            break;
-        }
-        case Silent:
+            GCodeTimeEstimator                  *estimator;
+            const char                          *time_mask;
+            const std::string                   *placeholder_tag;
+            G1LineIdToBlockIdMap::const_iterator it_line_id;
+            float                                last_recorded_time;
+        };
+        std::vector<RemainingTimes> remaining_times;
+        for (GCodeTimeEstimator *estimator : estimators)
         {
-            time_mask = "M73 Q%s S%s\n";
-            break;
-        }
+            RemainingTimes rt;
+            rt.estimator          = estimator;
+            rt.time_mask          = (estimator->_mode == Silent) ? "M73 Q%s S%s\n" : "M73 P%s R%s\n";
+            rt.placeholder_tag    = (estimator->_mode == Silent) ? &Silent_First_M73_Output_Placeholder_Tag : &Normal_First_M73_Output_Placeholder_Tag;
+            rt.it_line_id         = estimator->_g1_line_ids.begin();
+            rt.last_recorded_time = 0.0f;
+            remaining_times.emplace_back(rt);
         }
 
         unsigned int g1_lines_count = 0;
-        float last_recorded_time = 0.0f;
         std::string gcode_line;
         // buffer line to export only when greater than 64K to reduce writing calls
         std::string export_line;
         char time_line[64];
-		G1LineIdToBlockIdMap::const_iterator it_line_id = _g1_line_ids.begin();
-		while (std::getline(in, gcode_line))
+        GCodeReader &parser = estimators.front()->_parser;
+        while (std::getline(in, gcode_line))
         {
             if (!in.good())
             {
@@ -300,40 +311,48 @@ namespace Slic3r {
             }
 
             // replaces placeholders for initial line M73 with the real lines
-            if (((_mode == Normal) && (gcode_line == Normal_First_M73_Output_Placeholder_Tag)) ||
-                ((_mode == Silent) && (gcode_line == Silent_First_M73_Output_Placeholder_Tag)))
+            auto it_placeholder = std::find_if(remaining_times.begin(), remaining_times.end(),
+                [&gcode_line](const RemainingTimes &rt) { return gcode_line == *rt.placeholder_tag; });
+            if (it_placeholder != remaining_times.end())
             {
-                sprintf(time_line, time_mask.c_str(), "0", _get_time_minutes(_time).c_str());
+                sprintf(time_line, it_placeholder->time_mask, "0", _get_time_minutes(it_placeholder->estimator->_time).c_str());
                 gcode_line = time_line;
             }
             else
                gcode_line += "\n";
 
-            // add remaining time lines where needed
-            _parser.parse_line(gcode_line,
-                [this, &it_line_id, &g1_lines_count, &last_recorded_time, &time_line, &gcode_line, time_mask, interval](GCodeReader& reader, const GCodeReader::GCodeLine& line)
+            // add remaining time lines where needed, for all the estimators in a single pass over the file
+            parser.parse_line(gcode_line,
+                [&remaining_times, &g1_lines_count, &time_line, &gcode_line, interval](GCodeReader& reader, const GCodeReader::GCodeLine& line)
             {
                 if (line.cmd_is("G1"))
                 {
                     ++g1_lines_count;
 
-					assert(it_line_id == _g1_line_ids.end() || it_line_id->first >= g1_lines_count);
-
-					const Block *block = nullptr;
-					if (it_line_id != _g1_line_ids.end() && it_line_id->first == g1_lines_count) {
-						if (line.has_e() && it_line_id->second < (unsigned int)_blocks.size())
-							block = &_blocks[it_line_id->second];
-						++it_line_id;
-					}
+                    // A separate pass for each estimator inserted its line right after the G1 line, thus before
+                    // the lines of the preceding passes. Keep that order (silent mode before normal mode).
+                    for (auto it_rt = remaining_times.rbegin(); it_rt != remaining_times.rend(); ++ it_rt)
+                    {
+                        RemainingTimes &rt = *it_rt;
+                        const GCodeTimeEstimator &estimator = *rt.estimator;
+                        assert(rt.it_line_id == estimator._g1_line_ids.end() || rt.it_line_id->first >= g1_lines_count);
+
+                        const Block *block = nullptr;
+                        if (rt.it_line_id != estimator._g1_line_ids.end() && rt.it_line_id->first == g1_lines_count) {
+                            if (line.has_e() && rt.it_line_id->second < (unsigned int)estimator._blocks.size())
+                                block = &estimator._blocks[rt.it_line_id->second];
+                            ++rt.it_line_id;
+                        }
 
-					if (block != nullptr && block->elapsed_time != -1.0f) {
-                        float block_remaining_time = _time - block->elapsed_time;
-                        if (std::abs(last_recorded_time - block_remaining_time) > interval)
-                        {
-                            sprintf(time_line, time_mask.c_str(), std::to_string((int)(100.0f * block->elapsed_time / _time)).c_str(), _get_time_minutes(block_remaining_time).c_str());
-                            gcode_line += time_line;
+                        if (block != nullptr && block->elapsed_time != -1.0f) {
+                            float block_remaining_time = estimator._time - block->elapsed_time;
+                            if (std::abs(rt.last_recorded_time - block_remaining_time) > interval)
+                            {
+                                sprintf(time_line, rt.time_mask, std::to_string((int)(100.0f * block->elapsed_time / estimator._time)).c_str(), _get_time_minutes(block_remaining_time).c_str());
+                                gcode_line += time_line;
 
-                            last_recorded_time = block_remaining_time;
+                                rt.last_recorded_time = block_remaining_time;
+                            }
                         }
                     }
                 }
@@ -234,6 +234,8 @@ namespace Slic3r {
 
         // Adds the given gcode line
         void add_gcode_line(const std::string& gcode_line);
+        // Adds the given gcode line, already parsed by a GCodeReader
+        void add_gcode_line(const GCodeReader::GCodeLine& gcode_line) { this->_process_gcode_line(_parser, gcode_line); }
 
         void add_gcode_block(const char *ptr);
         void add_gcode_block(const std::string &str) { this->add_gcode_block(str.c_str()); }
@@ -259,6 +261,11 @@ namespace Slic3r {
         // This time estimator should have been already used to calculate the time estimate for the gcode
         // contained in the given file before to call this method
         bool post_process_remaining_times(const std::string& filename, float interval_sec);
+        // Process the gcode contained in the file with the given filename for all the given time estimators
+        // in a single pass over the file. The M73 lines of the estimators are placed in their order.
+        // The file is read and written once more: Which G1 lines get an M73 line depends on the elapsed times,
+        // which are final only after the whole gcode was planned, and the remaining times need the total time.
+        static bool post_process_remaining_times(const std::string& filename, float interval_sec, const std::vector<GCodeTimeEstimator*>& estimators);
 
         // Set current position on the given axis with the given value
         void set_axis_position(EAxis axis, float position);
@@ -1,5 +1,7 @@
 #include "GCodeWriter.hpp"
 #include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <iomanip>
 #include <iostream>
 #include <map>
@@ -14,6 +16,47 @@
 
 namespace Slic3r {
 
+static constexpr double pow10i(int exponent) { return exponent == 0 ? 1. : 10. * pow10i(exponent - 1); }
+
+// Append a number formatted the same way as std::fixed << std::setprecision(DIGITS) << value, without allocating memory.
+// The number is rounded to an integer number of 10^-DIGITS units and printed by integer arithmetic, unless it is huge
+// or too close to a rounding tie, in which case the rounding of the exact binary value is left to the C++ library.
+template<int DIGITS>
+static void append_fixed(std::string &out, double value)
+{
+    double scaled = std::abs(value) * pow10i(DIGITS);
+    // The comparison fails for NaN.
+    if (scaled < 1e12) {
+        double whole = std::floor(scaled);
+        double frac  = scaled - whole;
+        // The rounding error of scaled is below 1e-4, the rounding direction is unambiguous.
+        if (std::abs(frac - 0.5) > 1e-3) {
+            uint64_t n   = uint64_t(whole) + (frac > 0.5);
+            char     buf[32];
+            char    *end = buf + sizeof(buf);
+            char    *ptr = end;
+            for (int i = 0; i < DIGITS; ++ i, n /= 10)
+                *(-- ptr) = char('0' + n % 10);
+            *(-- ptr) = '.';
+            do {
+                *(-- ptr) = char('0' + n % 10);
+                n /= 10;
+            } while (n > 0);
+            // Negative zero is printed with the minus sign as well.
+            if (std::signbit(value))
+                *(-- ptr) = '-';
+            out.append(ptr, end);
+            return;
+        }
+    }
+    std::ostringstream ss;
+    ss << PRECISION(value, DIGITS);
+    out += ss.str();
+}
+
+static inline void append_xyzf(std::string &out, double value) { append_fixed<3>(out, value); }
+static inline void append_e   (std::string &out, double value) { append_fixed<5>(out, value); }
+
 void GCodeWriter::apply_print_config(const PrintConfig &print_config)
 {
     this->config.apply(print_config, true);
@@ -265,29 +308,47 @@ std::string GCodeWriter::toolchange(unsigned int extruder_id)
 }
 
 std::string GCodeWriter::set_speed(double F, const std::string &comment, const std::string &cooling_marker) const
+{
+    std::string gcode;
+    this->set_speed(gcode, F, comment, cooling_marker);
+    return gcode;
+}
+
+void GCodeWriter::set_speed(std::string &gcode, double F, const std::string &comment, const std::string &cooling_marker) const
 {
     assert(F > 0.);
     assert(F < 100000.);
-    std::ostringstream gcode;
-    gcode << "G1 F" << F;
-    COMMENT(comment);
-    gcode << cooling_marker;
-    gcode << "\n";
-    return gcode.str();
+    // Default formatting of a double by std::ostream.
+    char buf[64];
+    sprintf(buf, "G1 F%g", F);
+    gcode += buf;
+    if (this->config.gcode_comments && ! comment.empty())
+        (gcode += " ; ") += comment;
+    gcode += cooling_marker;
+    gcode += '\n';
 }
 
 std::string GCodeWriter::travel_to_xy(const Vec2d &point, const std::string &comment)
+{
+    std::string gcode;
+    this->travel_to_xy(gcode, point, comment);
+    return gcode;
+}
+
+void GCodeWriter::travel_to_xy(std::string &gcode, const Vec2d &point, const std::string &comment)
 {
     m_pos(0) = point(0);
     m_pos(1) = point(1);
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<   " F" << XYZF_NUM(this->config.travel_speed.value * 60.0);
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    gcode += "G1 X";
+    append_xyzf(gcode, point(0));
+    gcode += " Y";
+    append_xyzf(gcode, point(1));
+    gcode += " F";
+    append_xyzf(gcode, this->config.travel_speed.value * 60.0);
+    if (this->config.gcode_comments && ! comment.empty())
+        (gcode += " ; ") += comment;
+    gcode += '\n';
 }
 
 std::string GCodeWriter::travel_to_xyz(const Vec3d &point, const std::string &comment)
@@ -307,14 +368,18 @@ std::string GCodeWriter::travel_to_xyz(const Vec3d &point, const std::string &co
     m_lifted = 0;
     m_pos = point;
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<   " Z" << XYZF_NUM(point(2))
-          <<   " F" << XYZF_NUM(this->config.travel_speed.value * 60.0);
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    std::string gcode = "G1 X";
+    append_xyzf(gcode, point(0));
+    gcode += " Y";
+    append_xyzf(gcode, point(1));
+    gcode += " Z";
+    append_xyzf(gcode, point(2));
+    gcode += " F";
+    append_xyzf(gcode, this->config.travel_speed.value * 60.0);
+    if (this->config.gcode_comments && ! comment.empty())
+        (gcode += " ; ") += comment;
+    gcode += '\n';
+    return gcode;
 }
 
 std::string GCodeWriter::travel_to_z(double z, const std::string &comment)
@@ -338,12 +403,14 @@ std::string GCodeWriter::_travel_to_z(double z, const std::string &comment)
 {
     m_pos(2) = z;
     
-    std::ostringstream gcode;
-    gcode << "G1 Z" << XYZF_NUM(z)
-          <<   " F" << XYZF_NUM(this->config.travel_speed.value * 60.0);
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    std::string gcode = "G1 Z";
+    append_xyzf(gcode, z);
+    gcode += " F";
+    append_xyzf(gcode, this->config.travel_speed.value * 60.0);
+    if (this->config.gcode_comments && ! comment.empty())
+        (gcode += " ; ") += comment;
+    gcode += '\n';
+    return gcode;
 }
 
 bool GCodeWriter::will_move_z(double z) const
@@ -359,18 +426,28 @@ bool GCodeWriter::will_move_z(double z) const
 }
 
 std::string GCodeWriter::extrude_to_xy(const Vec2d &point, double dE, const std::string &comment)
+{
+    std::string gcode;
+    this->extrude_to_xy(gcode, point, dE, comment);
+    return gcode;
+}
+
+void GCodeWriter::extrude_to_xy(std::string &gcode, const Vec2d &point, double dE, const std::string &comment)
 {
     m_pos(0) = point(0);
     m_pos(1) = point(1);
     m_extruder->extrude(dE);
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<    " " << m_extrusion_axis << E_NUM(m_extruder->E());
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    gcode += "G1 X";
+    append_xyzf(gcode, point(0));
+    gcode += " Y";
+    append_xyzf(gcode, point(1));
+    gcode += ' ';
+    gcode += m_extrusion_axis;
+    append_e(gcode, m_extruder->E());
+    if (this->config.gcode_comments && ! comment.empty())
+        (gcode += " ; ") += comment;
+    gcode += '\n';
 }
 
 std::string GCodeWriter::extrude_to_xyz(const Vec3d &point, double dE, const std::string &comment)
@@ -379,14 +456,19 @@ std::string GCodeWriter::extrude_to_xyz(const Vec3d &point, double dE, const std
     m_lifted = 0;
     m_extruder->extrude(dE);
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<   " Z" << XYZF_NUM(point(2))
-          <<    " " << m_extrusion_axis << E_NUM(m_extruder->E());
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    std::string gcode = "G1 X";
+    append_xyzf(gcode, point(0));
+    gcode += " Y";
+    append_xyzf(gcode, point(1));
+    gcode += " Z";
+    append_xyzf(gcode, point(2));
+    gcode += ' ';
+    gcode += m_extrusion_axis;
+    append_e(gcode, m_extruder->E());
+    if (this->config.gcode_comments && ! comment.empty())
+        (gcode += " ; ") += comment;
+    gcode += '\n';
+    return gcode;
 }
 
 std::string GCodeWriter::retract(bool before_wipe)
@@ -413,7 +495,7 @@ std::string GCodeWriter::retract_for_toolchange(bool before_wipe)
 
 std::string GCodeWriter::_retract(double length, double restart_extra, const std::string &comment)
 {
-    std::ostringstream gcode;
+    std::string gcode;
     
     /*  If firmware retraction is enabled, we use a fake value of 1
         since we ignore the actual configured retract_length which 
@@ -432,48 +514,56 @@ std::string GCodeWriter::_retract(double length, double restart_extra, const std
     if (dE != 0) {
         if (this->config.use_firmware_retraction) {
             if (FLAVOR_IS(gcfMachinekit))
-                gcode << "G22 ; retract\n";
+                gcode += "G22 ; retract\n";
             else
-                gcode << "G10 ; retract\n";
+                gcode += "G10 ; retract\n";
         } else {
-            gcode << "G1 " << m_extrusion_axis << E_NUM(m_extruder->E())
-                           << " F" << float(m_extruder->retract_speed() * 60.);
-            COMMENT(comment);
-            gcode << "\n";
+            // The feed rate has always been printed with the fixed precision of E.
+            gcode += "G1 ";
+            gcode += m_extrusion_axis;
+            append_e(gcode, m_extruder->E());
+            gcode += " F";
+            append_e(gcode, float(m_extruder->retract_speed() * 60.));
+            if (this->config.gcode_comments && ! comment.empty())
+                (gcode += " ; ") += comment;
+            gcode += '\n';
         }
     }
     
     if (FLAVOR_IS(gcfMakerWare))
-        gcode << "M103 ; extruder off\n";
+        gcode += "M103 ; extruder off\n";
     
-    return gcode.str();
+    return gcode;
 }
 
 std::string GCodeWriter::unretract()
 {
-    std::ostringstream gcode;
+    std::string gcode;
     
     if (FLAVOR_IS(gcfMakerWare))
-        gcode << "M101 ; extruder on\n";
+        gcode += "M101 ; extruder on\n";
     
     double dE = m_extruder->unretract();
     if (dE != 0) {
         if (this->config.use_firmware_retraction) {
             if (FLAVOR_IS(gcfMachinekit))
-                 gcode << "G23 ; unretract\n";
+                 gcode += "G23 ; unretract\n";
             else
-                 gcode << "G11 ; unretract\n";
-            gcode << this->reset_e();
+                 gcode += "G11 ; unretract\n";
+            gcode += this->reset_e();
         } else {
             // use G1 instead of G0 because G0 will blend the restart with the previous travel move
-            gcode << "G1 " << m_extrusion_axis << E_NUM(m_extruder->E())
-                           << " F" << float(m_extruder->deretract_speed() * 60.);
-            if (this->config.gcode_comments) gcode << " ; unretract";
-            gcode << "\n";
+            gcode += "G1 ";
+            gcode += m_extrusion_axis;
+            append_e(gcode, m_extruder->E());
+            gcode += " F";
+            append_e(gcode, float(m_extruder->deretract_speed() * 60.));
+            if (this->config.gcode_comments) gcode += " ; unretract";
+            gcode += '\n';
         }
     }
     
-    return gcode.str();
+    return gcode;
 }
 
 /*  If this method is called more than once before calling unlift(),
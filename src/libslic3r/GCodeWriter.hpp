@@ -6,7 +6,6 @@
 #include "Extruder.hpp"
 #include "Point.hpp"
 #include "PrintConfig.hpp"
-#include "GCode/CoolingBuffer.hpp"
 
 namespace Slic3r {
 
@@ -56,6 +55,11 @@ public:
     std::string toolchange(unsigned int extruder_id);
     std::string set_speed(double F, const std::string &comment = std::string(), const std::string &cooling_marker = std::string()) const;
     std::string travel_to_xy(const Vec2d &point, const std::string &comment = std::string());
+    // The following variants append the G-code line to the gcode buffer instead of returning a new string,
+    // to be used by the inner loops of the G-code export.
+    void        set_speed(std::string &gcode, double F, const std::string &comment = std::string(), const std::string &cooling_marker = std::string()) const;
+    void        travel_to_xy(std::string &gcode, const Vec2d &point, const std::string &comment = std::string());
+    void        extrude_to_xy(std::string &gcode, const Vec2d &point, double dE, const std::string &comment = std::string());
     std::string travel_to_xyz(const Vec3d &point, const std::string &comment = std::string());
     std::string travel_to_z(double z, const std::string &comment = std::string());
     bool        will_move_z(double z) const;
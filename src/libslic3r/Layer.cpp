@@ -36,6 +36,7 @@ LayerRegion* Layer::add_region(PrintRegion* print_region)
 // merge all regions' slices to get islands
 void Layer::make_slices()
 {
+    this->clear_slices_edge_grid();
     ExPolygons slices;
     if (m_regions.size() == 1) {
         // optimization: if we only have one region, take its slices
@@ -65,6 +66,24 @@ void Layer::make_slices()
         this->slices.expolygons.push_back(std::move(slices[i]));
 }
 
+const EdgeGrid::Grid& Layer::slices_edge_grid() const
+{
+    std::lock_guard<std::mutex> lock(m_slices_edge_grid_mutex);
+    if (! m_slices_edge_grid) {
+        const coord_t distance_field_resolution = coord_t(scale_(1.) + 0.5);
+        m_slices_edge_grid.reset(new EdgeGrid::Grid());
+        m_slices_edge_grid->create(this->slices, distance_field_resolution);
+        m_slices_edge_grid->calculate_sdf();
+    }
+    return *m_slices_edge_grid;
+}
+
+void Layer::clear_slices_edge_grid() const
+{
+    std::lock_guard<std::mutex> lock(m_slices_edge_grid_mutex);
+    m_slices_edge_grid.reset();
+}
+
 void Layer::merge_slices()
 {
     if (m_regions.size() == 1) {
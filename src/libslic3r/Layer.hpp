@@ -7,7 +7,10 @@
 #include "ExtrusionEntityCollection.hpp"
 #include "ExPolygonCollection.hpp"
 #include "PolylineCollection.hpp"
+#include "EdgeGrid.hpp"
 
+#include <memory>
+#include <mutex>
 
 namespace Slic3r {
 
@@ -118,6 +121,11 @@ public:
     bool                    empty() const;    
     void                    make_slices();
     void                    merge_slices();
+    // Edge grid over the slices with a signed distance field. The G-code generator uses it to find overhangs
+    // of the layer above when placing seams. Built on the first call, thread safe.
+    const EdgeGrid::Grid&   slices_edge_grid() const;
+    // Release the edge grid. Called once the layer above has been exported, and whenever the slices change.
+    void                    clear_slices_edge_grid() const;
     template <class T> bool any_internal_region_slice_contains(const T &item) const {
         for (const LayerRegion *layerm : m_regions) if (layerm->slices.any_internal_contains(item)) return true;
         return false;
@@ -152,6 +160,9 @@ private:
     size_t              m_id;
     PrintObject        *m_object;
     LayerRegionPtrs     m_regions;
+
+    mutable std::unique_ptr<EdgeGrid::Grid> m_slices_edge_grid;
+    mutable std::mutex                      m_slices_edge_grid_mutex;
 };
 
 class SupportLayer : public Layer 
@@ -12,7 +12,20 @@ using boost::polygon::voronoi_diagram;
 
 namespace Slic3r {
 
-MotionPlanner::MotionPlanner(const ExPolygons &islands) : m_initialized(false)
+static inline bool islands_equal(const MotionPlannerEnv &env1, const MotionPlannerEnv &env2)
+{
+    const ExPolygon &island1 = env1.island();
+    const ExPolygon &island2 = env2.island();
+    if (env1.island_bbox().min != env2.island_bbox().min || env1.island_bbox().max != env2.island_bbox().max ||
+        island1.contour.points != island2.contour.points || island1.holes.size() != island2.holes.size())
+        return false;
+    for (size_t i = 0; i < island1.holes.size(); ++ i)
+        if (island1.holes[i].points != island2.holes[i].points)
+            return false;
+    return true;
+}
+
+MotionPlanner::MotionPlanner(const ExPolygons &islands, const MotionPlanner *previous) : m_initialized(false)
 {
     ExPolygons expp;
     for (const ExPolygon &island : islands) {
@@ -21,6 +34,27 @@ MotionPlanner::MotionPlanner(const ExPolygons &islands) : m_initialized(false)
             m_islands.emplace_back(MotionPlannerEnv(island));
         expp.clear();
     }
+    m_graphs.assign(m_islands.size() + 1, nullptr);
+
+    if (previous != nullptr) {
+        // The graph of an island depends on the island only, share the graphs of the equal islands.
+        // The graph of the outer environment depends on all the islands and their order.
+        bool all_islands_equal = m_islands.size() == previous->m_islands.size();
+        for (size_t i = 0; i < m_islands.size(); ++ i) {
+            if (i < previous->m_islands.size() && islands_equal(m_islands[i], previous->m_islands[i])) {
+                m_graphs[i + 1] = previous->m_graphs[i + 1];
+                continue;
+            }
+            all_islands_equal = false;
+            for (size_t j = 0; j < previous->m_islands.size(); ++ j)
+                if (islands_equal(m_islands[i], previous->m_islands[j])) {
+                    m_graphs[i + 1] = previous->m_graphs[j + 1];
+                    break;
+                }
+        }
+        if (all_islands_equal)
+            m_graphs.front() = previous->m_graphs.front();
+    }
 }
 
 void MotionPlanner::initialize()
@@ -50,7 +84,6 @@ void MotionPlanner::initialize()
     // from Clipper data structure into the Slic3r expolygons inside diff_ex().
     m_outer = MotionPlannerEnv(outer.front());
     m_outer.m_env = ExPolygonCollection(diff_ex(contour, offset(outer_holes, +MP_OUTER_MARGIN)));
-    m_graphs.resize(m_islands.size() + 1);
     m_initialized = true;
 }
 
@@ -181,11 +214,10 @@ Polyline MotionPlanner::shortest_path(const Point &from, const Point &to)
 const MotionPlannerGraph& MotionPlanner::init_graph(int island_idx)
 {
     // 0th graph is the graph for m_outer. Other graphs are 1 indexed.
-    MotionPlannerGraph *graph = m_graphs[island_idx + 1].get();
-    if (graph == nullptr) {
+    std::shared_ptr<const MotionPlannerGraph> &graph_ptr = m_graphs[island_idx + 1];
+    if (graph_ptr == nullptr) {
         // If this graph doesn't exist, initialize it.
-        m_graphs[island_idx + 1] = make_unique<MotionPlannerGraph>();
-        graph = m_graphs[island_idx + 1].get();
+        std::shared_ptr<MotionPlannerGraph> graph = std::make_shared<MotionPlannerGraph>();
         
         /*  We don't add polygon boundaries as graph edges, because we'd need to connect
             them to the Voronoi-generated edges by recognizing coinciding nodes. */
@@ -227,9 +259,11 @@ const MotionPlannerGraph& MotionPlanner::init_graph(int island_idx)
                 graph->add_edge(v0_idx, v1_idx, (p1 - p0).cast<double>().norm());
             }
         }
+        graph->index_nodes();
+        graph_ptr = std::move(graph);
     }
 
-    return *graph;
+    return *graph_ptr;
 }
 
 // Find a middle point on the path from start_point to end_point with the shortest path.
@@ -304,6 +338,102 @@ void MotionPlannerGraph::add_edge(size_t from, size_t to, double weight)
     m_adjacency_list[from].emplace_back(Neighbor(node_t(to), weight));
 }
 
+void MotionPlannerGraph::index_nodes()
+{
+    m_grid_cell_start.clear();
+    m_grid_nodes.clear();
+    if (m_nodes.empty())
+        return;
+
+    // Size the cells to hold a single node on average, but don't allocate more cells than twice the number of nodes for degenerate bounding boxes.
+    m_grid_bbox = BoundingBox(m_nodes);
+    const double width  = double(m_grid_bbox.max(0) - m_grid_bbox.min(0)) + 1.;
+    const double height = double(m_grid_bbox.max(1) - m_grid_bbox.min(1)) + 1.;
+    const double num_nodes = double(m_nodes.size());
+    m_grid_cell_size = coord_t(std::ceil(std::max(std::sqrt(width * height / num_nodes), std::max(width, height) / num_nodes)));
+    m_grid_cols = int(width  / double(m_grid_cell_size)) + 1;
+    m_grid_rows = int(height / double(m_grid_cell_size)) + 1;
+
+    // Counting sort of the nodes by their cells.
+    auto cell_idx = [this](const Point &pt) {
+        return size_t((pt(1) - m_grid_bbox.min(1)) / m_grid_cell_size) * m_grid_cols + size_t((pt(0) - m_grid_bbox.min(0)) / m_grid_cell_size);
+    };
+    m_grid_cell_start.assign(size_t(m_grid_cols) * size_t(m_grid_rows) + 1, 0);
+    for (const Point &pt : m_nodes)
+        ++ m_grid_cell_start[cell_idx(pt) + 1];
+    for (size_t i = 1; i < m_grid_cell_start.size(); ++ i)
+        m_grid_cell_start[i] += m_grid_cell_start[i - 1];
+    std::vector<size_t> cell_end(m_grid_cell_start.begin(), m_grid_cell_start.end() - 1);
+    m_grid_nodes.assign(m_nodes.size(), 0);
+    for (size_t i = 0; i < m_nodes.size(); ++ i)
+        m_grid_nodes[cell_end[cell_idx(m_nodes[i])] ++] = node_t(i);
+}
+
+size_t MotionPlannerGraph::find_closest_node(const Point &point) const
+{
+    if (m_grid_nodes.empty())
+        return point.nearest_point_index(m_nodes);
+
+    // Point clamped to the grid. Its distance to a node inside the grid is not larger than the distance of the point itself.
+    const Point pt_grid(
+        clamp(m_grid_bbox.min(0), m_grid_bbox.max(0), point(0)), 
+        clamp(m_grid_bbox.min(1), m_grid_bbox.max(1), point(1)));
+    const int col = std::min(m_grid_cols - 1, int((pt_grid(0) - m_grid_bbox.min(0)) / m_grid_cell_size));
+    const int row = std::min(m_grid_rows - 1, int((pt_grid(1) - m_grid_bbox.min(1)) / m_grid_cell_size));
+
+    size_t idx_min  = size_t(-1);
+    double dist_min = std::numeric_limits<double>::max();
+    auto visit_cell = [this, &point, &idx_min, &dist_min](int c, int r) {
+        size_t cell = size_t(r) * size_t(m_grid_cols) + size_t(c);
+        for (size_t i = m_grid_cell_start[cell]; i < m_grid_cell_start[cell + 1]; ++ i) {
+            size_t idx = size_t(m_grid_nodes[i]);
+            double d   = (m_nodes[idx] - point).cast<double>().squaredNorm();
+            // Resolve the ties the same way as Point::nearest_point_index() does: 
+            // The first coincident node wins, otherwise the last of the equally distant nodes wins.
+            if (d < dist_min || (d == dist_min && (d == 0. ? idx < idx_min : idx > idx_min))) {
+                idx_min  = idx;
+                dist_min = d;
+            }
+        }
+    };
+
+    // Visit the rings of cells around the cell of pt_grid.
+    for (int radius = 0;; ++ radius) {
+        const int c0 = col - radius;
+        const int c1 = col + radius;
+        const int r0 = row - radius;
+        const int r1 = row + radius;
+        for (int r = std::max(r0, 0); r <= std::min(r1, m_grid_rows - 1); ++ r)
+            if (r == r0 || r == r1) {
+                for (int c = std::max(c0, 0); c <= std::min(c1, m_grid_cols - 1); ++ c)
+                    visit_cell(c, r);
+            } else {
+                if (c0 >= 0)
+                    visit_cell(c0, r);
+                if (c1 < m_grid_cols)
+                    visit_cell(c1, r);
+            }
+        if (c0 <= 0 && r0 <= 0 && c1 >= m_grid_cols - 1 && r1 >= m_grid_rows - 1)
+            // All cells were visited.
+            break;
+        if (idx_min != size_t(-1)) {
+            // Distance of pt_grid to the cells not visited yet.
+            double d = std::numeric_limits<double>::max();
+            if (c0 > 0)
+                d = std::min(d, double(pt_grid(0) - m_grid_bbox.min(0)) - double(c0) * double(m_grid_cell_size));
+            if (c1 < m_grid_cols - 1)
+                d = std::min(d, double(c1 + 1) * double(m_grid_cell_size) - double(pt_grid(0) - m_grid_bbox.min(0)));
+            if (r0 > 0)
+                d = std::min(d, double(pt_grid(1) - m_grid_bbox.min(1)) - double(r0) * double(m_grid_cell_size));
+            if (r1 < m_grid_rows - 1)
+                d = std::min(d, double(r1 + 1) * double(m_grid_cell_size) - double(pt_grid(1) - m_grid_bbox.min(1)));
+            if (d * d > dist_min)
+                break;
+        }
+    }
+    return idx_min;
+}
+
 // Dijkstra's shortest path in a weighted graph from node_start to node_end.
 // The returned path contains the end points.
 // If no path exists from node_start to node_end, a straight segment is returned.
@@ -30,6 +30,8 @@ public:
         { return m_island_bbox.contains(pt) && m_island.contains(pt); }
     bool  island_contains_b(const Point &pt) const
         { return m_island_bbox.contains(pt) && m_island.contains_b(pt); }
+    const ExPolygon&   island()      const { return m_island; }
+    const BoundingBox& island_bbox() const { return m_island_bbox; }
 
 private:
     ExPolygon           m_island;
@@ -45,7 +47,11 @@ public:
     // Add a directed edge into the graph.
     size_t   add_node(const Point &p) { m_nodes.emplace_back(p); return m_nodes.size() - 1; }
     void     add_edge(size_t from, size_t to, double weight);
-    size_t   find_closest_node(const Point &point) const { return point.nearest_point_index(m_nodes); }
+    // Find the node closest to point. Returns the same node as point.nearest_point_index(nodes) would,
+    // but if the nodes were indexed by index_nodes(), only the grid cells around point are searched.
+    size_t   find_closest_node(const Point &point) const;
+    // Build a grid index of the nodes for find_closest_node(). To be called after all the nodes were added.
+    void     index_nodes();
 
     bool     empty() const { return m_adjacency_list.empty(); }
     Polyline shortest_path(size_t from, size_t to) const;
@@ -62,23 +68,37 @@ private:
     };
     Points                              m_nodes;
     std::vector<std::vector<Neighbor>>  m_adjacency_list;
+
+    // Regular grid over the nodes, built by index_nodes().
+    BoundingBox                         m_grid_bbox;
+    coord_t                             m_grid_cell_size = 0;
+    int                                 m_grid_cols = 0;
+    int                                 m_grid_rows = 0;
+    // Nodes of a grid cell are stored at m_grid_nodes[m_grid_cell_start[cell] .. m_grid_cell_start[cell + 1]).
+    std::vector<size_t>                 m_grid_cell_start;
+    std::vector<node_t>                 m_grid_nodes;
 };
 
 class MotionPlanner
 {
 public:
-    MotionPlanner(const ExPolygons &islands);
+    // If a previous motion planner is provided (typically the motion planner of the layer below),
+    // the visibility graphs of the islands equal to the islands of the previous motion planner are shared.
+    MotionPlanner(const ExPolygons &islands, const MotionPlanner *previous = nullptr);
     ~MotionPlanner() {}
 
     Polyline    shortest_path(const Point &from, const Point &to);
     size_t      islands_count() const { return m_islands.size(); }
+    // Visibility graph of an island (-1 for the outer environment), nullptr if it was not built or shared yet.
+    const MotionPlannerGraph* graph(int island_idx) const { return m_graphs[island_idx + 1].get(); }
 
 private:
     bool                                m_initialized;
     std::vector<MotionPlannerEnv>       m_islands;
     MotionPlannerEnv                    m_outer;
     // 0th graph is the graph for m_outer. Other graphs are 1 indexed.
-    std::vector<std::unique_ptr<MotionPlannerGraph>> m_graphs;
+    // The graphs are immutable once created, therefore they may be shared with the motion planners of the layers above.
+    std::vector<std::shared_ptr<const MotionPlannerGraph>> m_graphs;
     
     void                      initialize();
     const MotionPlannerGraph& init_graph(int island_idx);
@@ -49,7 +49,9 @@
 #include <boost/phoenix/bind/bind_function.hpp>
 
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 // #define USE_CPP11_REGEX
 #ifdef USE_CPP11_REGEX
@@ -684,6 +686,8 @@ namespace client
                     opt_key_str.resize(opt_key_str.size() - 1);
                 opt = ctx->resolve_symbol(opt_key_str);
             }
+            if (opt == nullptr)
+                ctx->throw_exception("Variable does not exist", opt_key);
             if (! opt->is_vector())
                 ctx->throw_exception("Trying to index a scalar variable", opt_key);
             const ConfigOptionVectorBase *vec = static_cast<const ConfigOptionVectorBase*>(opt);
@@ -1254,12 +1258,241 @@ static std::string process_macro(const std::string &templ, client::MyContext &co
     return output;
 }
 
+// Custom G-code templates are mostly made of free-form text and simple variable references, and the same templates
+// (before_layer_gcode, layer_gcode, toolchange_gcode ...) are processed over and over for each layer or tool change.
+// Such templates are split into a sequence of text blocks and variable references just once, so that they may be
+// evaluated by a few config lookups instead of running the boost::spirit parser.
+// Templates containing conditions or expressions are not compiled and they are always processed by the macro_processor.
+struct CompiledTemplate
+{
+    enum SegmentType {
+        // Free-form text, copied to the output without a modification.
+        SEGMENT_TEXT,
+        // Legacy [scalar_variable] or [vector_variable_index].
+        SEGMENT_LEGACY_VARIABLE,
+        // Legacy [vector_variable[index_variable]].
+        SEGMENT_LEGACY_INDEXED_VARIABLE,
+        // {scalar_variable}
+        SEGMENT_VARIABLE,
+        // {vector_variable[index_variable]} or {vector_variable[integer]}
+        SEGMENT_INDEXED_VARIABLE,
+    };
+
+    struct Segment {
+        Segment(SegmentType type, std::string &&text) : type(type), text(std::move(text)) {}
+        SegmentType     type;
+        // Text of SEGMENT_TEXT, name of the variable otherwise.
+        std::string     text;
+        // Name of the index variable, empty if the index is a constant.
+        std::string     index;
+        int             index_value = 0;
+    };
+
+    // If false, the template has to be processed by the macro_processor.
+    bool                    valid = false;
+    std::vector<Segment>    segments;
+};
+
+static bool is_identifier_start(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+static bool is_identifier_char (char c) { return is_identifier_start(c) || (c >= '0' && c <= '9'); }
+
+// Parse an identifier starting at templ[i] the same way the macro_processor does, reject the keywords.
+static bool compile_identifier(const std::string &templ, size_t &i, std::string &out)
+{
+    static const char *keywords[] = { "and", "if", "else", "elsif", "endif", "false", "min", "max", "not", "or", "true" };
+    if (i == templ.size() || ! is_identifier_start(templ[i]))
+        return false;
+    size_t begin = i;
+    for (++ i; i < templ.size() && is_identifier_char(templ[i]); ++ i) ;
+    out.assign(templ, begin, i - begin);
+    for (const char *keyword : keywords)
+        if (out == keyword)
+            return false;
+    return true;
+}
+
+static CompiledTemplate compile_template(const std::string &templ)
+{
+    CompiledTemplate out;
+    // The macro_processor skips the white spaces at the start of the template.
+    size_t i = 0;
+    for (; i < templ.size() && std::isspace((unsigned char)templ[i]); ++ i) ;
+    while (i < templ.size()) {
+        char c = templ[i];
+        if (c == '[' || c == '{') {
+            // Only [variable], [variable[variable]], {variable}, {variable[variable]} and {variable[integer]} are compiled,
+            // anything else including white spaces inside the brackets is left to the macro_processor.
+            bool        legacy = c == '[';
+            std::string key;
+            if (! compile_identifier(templ, ++ i, key) || i == templ.size())
+                return CompiledTemplate();
+            if (templ[i] == (legacy ? ']' : '}')) {
+                out.segments.emplace_back(legacy ? CompiledTemplate::SEGMENT_LEGACY_VARIABLE : CompiledTemplate::SEGMENT_VARIABLE, std::move(key));
+            } else if (templ[i] == '[') {
+                CompiledTemplate::Segment segment(legacy ? CompiledTemplate::SEGMENT_LEGACY_INDEXED_VARIABLE : CompiledTemplate::SEGMENT_INDEXED_VARIABLE, std::move(key));
+                ++ i;
+                if (! legacy && i < templ.size() && templ[i] >= '0' && templ[i] <= '9') {
+                    size_t begin = i;
+                    for (; i < templ.size() && templ[i] >= '0' && templ[i] <= '9'; ++ i) ;
+                    if (i - begin > 9)
+                        return CompiledTemplate();
+                    segment.index_value = atoi(templ.c_str() + begin);
+                } else if (! compile_identifier(templ, i, segment.index))
+                    return CompiledTemplate();
+                if (i + 1 >= templ.size() || templ[i] != ']' || templ[++ i] != (legacy ? ']' : '}'))
+                    return CompiledTemplate();
+                out.segments.emplace_back(std::move(segment));
+            } else
+                return CompiledTemplate();
+            ++ i;
+        } else {
+            size_t begin = i;
+            for (; i < templ.size() && templ[i] != '[' && templ[i] != '{'; ++ i)
+                // Leave the validation of UTF-8 sequences to the macro_processor.
+                if ((unsigned char)templ[i] >= 0x80)
+                    return CompiledTemplate();
+            out.segments.emplace_back(CompiledTemplate::SEGMENT_TEXT, templ.substr(begin, i - begin));
+        }
+    }
+    out.valid = true;
+    return out;
+}
+
+// Compile the template or return the template compiled by one of the previous calls.
+static std::shared_ptr<const CompiledTemplate> compiled_template(const std::string &templ)
+{
+    static std::mutex                                                               mutex;
+    static std::unordered_map<std::string, std::shared_ptr<const CompiledTemplate>> cache;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(templ);
+    if (it != cache.end())
+        return it->second;
+    // Templates being edited may be processed on each key stroke, keep the cache bounded.
+    if (cache.size() >= 1024)
+        cache.clear();
+    auto compiled = std::make_shared<const CompiledTemplate>(compile_template(templ));
+    cache.emplace(templ, compiled);
+    return compiled;
+}
+
+// Format a floating point number the same way expr::to_string() does.
+template<typename T>
+static void append_number(T value, std::string &output)
+{
+    std::ostringstream ss;
+    ss << value;
+    output += ss.str();
+}
+
+// Evaluate the compiled template with the semantics of the macro_processor.
+// Returns false if the evaluation failed. In that case the template shall be processed by the macro_processor
+// to produce the error message.
+static bool evaluate_compiled_template(const CompiledTemplate &templ, const client::MyContext &context, std::string &output)
+{
+    for (const CompiledTemplate::Segment &segment : templ.segments) {
+        switch (segment.type) {
+        case CompiledTemplate::SEGMENT_TEXT:
+            output += segment.text;
+            break;
+        case CompiledTemplate::SEGMENT_LEGACY_VARIABLE:
+        {
+            // See client::MyContext::legacy_variable_expansion()
+            const ConfigOption *opt = context.resolve_symbol(segment.text);
+            size_t              idx = context.current_extruder_id;
+            if (opt == nullptr) {
+                // Check whether this is a legacy vector indexing.
+                size_t pos = segment.text.rfind('_');
+                if (pos == std::string::npos || (opt = context.resolve_symbol(segment.text.substr(0, pos))) == nullptr || ! opt->is_vector())
+                    return false;
+                char *endptr = nullptr;
+                idx = strtol(segment.text.c_str() + pos + 1, &endptr, 10);
+                if (endptr == nullptr || *endptr != 0)
+                    return false;
+            }
+            if (opt->is_scalar())
+                output += opt->serialize();
+            else {
+                const ConfigOptionVectorBase *vec = static_cast<const ConfigOptionVectorBase*>(opt);
+                if (vec->empty())
+                    return false;
+                output += vec->vserialize()[(idx >= vec->size()) ? 0 : idx];
+            }
+            break;
+        }
+        case CompiledTemplate::SEGMENT_LEGACY_INDEXED_VARIABLE:
+        {
+            // See client::MyContext::legacy_variable_expansion2()
+            const ConfigOption *opt = context.resolve_symbol(segment.text);
+            if (opt == nullptr && segment.text.back() == '_')
+                opt = context.resolve_symbol(segment.text.substr(0, segment.text.size() - 1));
+            if (opt == nullptr || ! opt->is_vector())
+                return false;
+            const ConfigOptionVectorBase *vec = static_cast<const ConfigOptionVectorBase*>(opt);
+            const ConfigOption           *opt_index = context.resolve_symbol(segment.index);
+            if (vec->empty() || opt_index == nullptr || opt_index->type() != coInt || opt_index->getInt() < 0)
+                return false;
+            int idx = opt_index->getInt();
+            output += vec->vserialize()[(idx >= (int)vec->size()) ? 0 : idx];
+            break;
+        }
+        case CompiledTemplate::SEGMENT_VARIABLE:
+        {
+            // See client::MyContext::scalar_variable_reference() and expr::to_string()
+            const ConfigOption *opt = context.resolve_symbol(segment.text);
+            if (opt == nullptr)
+                return false;
+            switch (opt->type()) {
+            case coFloat:
+            case coPercent: append_number(opt->getFloat(), output); break;
+            case coInt:     output += std::to_string(opt->getInt()); break;
+            case coString:  output += static_cast<const ConfigOptionString*>(opt)->value; break;
+            case coPoint:   output += opt->serialize(); break;
+            case coBool:    output += opt->getBool() ? "true" : "false"; break;
+            default:        return false;
+            }
+            break;
+        }
+        case CompiledTemplate::SEGMENT_INDEXED_VARIABLE:
+        {
+            // See client::MyContext::vector_variable_reference() and expr::to_string()
+            int idx = segment.index_value;
+            if (! segment.index.empty()) {
+                const ConfigOption *opt_index = context.resolve_symbol(segment.index);
+                if (opt_index == nullptr || opt_index->type() != coInt)
+                    return false;
+                idx = opt_index->getInt();
+            }
+            const ConfigOption *opt = context.resolve_symbol(segment.text);
+            if (opt == nullptr || ! opt->is_vector() || static_cast<const ConfigOptionVectorBase*>(opt)->empty())
+                return false;
+            size_t i = (idx < 0 || idx >= int(static_cast<const ConfigOptionVectorBase*>(opt)->size())) ? 0 : size_t(idx);
+            switch (opt->type()) {
+            case coFloats:   append_number(static_cast<const ConfigOptionFloats  *>(opt)->values[i], output); break;
+            case coPercents: append_number(static_cast<const ConfigOptionPercents*>(opt)->values[i], output); break;
+            case coInts:     output += std::to_string(static_cast<const ConfigOptionInts*>(opt)->values[i]); break;
+            case coStrings:  output += static_cast<const ConfigOptionStrings*>(opt)->values[i]; break;
+            case coBools:    output += (static_cast<const ConfigOptionBools*>(opt)->values[i] != 0) ? "true" : "false"; break;
+            default:         return false;
+            }
+            break;
+        }
+        }
+    }
+    return true;
+}
+
 std::string PlaceholderParser::process(const std::string &templ, unsigned int current_extruder_id, const DynamicConfig *config_override) const
 {
     client::MyContext context;
     context.config              = &this->config();
     context.config_override     = config_override;
     context.current_extruder_id = current_extruder_id;
+    if (m_compile_templates) {
+        std::shared_ptr<const CompiledTemplate> compiled = compiled_template(templ);
+        std::string output;
+        if (compiled->valid && evaluate_compiled_template(*compiled, context, output))
+            return output;
+    }
     return process_macro(templ, context);
 }
 
@@ -39,6 +39,9 @@ public:
     // Fill in the template using a macro processing language.
     // Throws std::runtime_error on syntax or runtime error.
     std::string process(const std::string &templ, unsigned int current_extruder_id, const DynamicConfig *config_override = nullptr) const;
+    // Templates made of free-form text and simple variable references are evaluated from a cached compiled form.
+    // If disabled, all templates are processed by the macro processor. The tests compare the results of the two.
+    void set_compile_templates(bool enable) { m_compile_templates = enable; }
     
     // Evaluate a boolean expression using the full expressive power of the PlaceholderParser boolean expression syntax.
     // Throws std::runtime_error on syntax or runtime error.
@@ -51,6 +54,7 @@ public:
 
 private:
     DynamicConfig m_config;
+    bool          m_compile_templates = true;
 };
 
 }
@@ -345,6 +345,7 @@ void Print::_simplify_slices(double distance)
     for (PrintObject *object : m_objects) {
         for (Layer *layer : object->m_layers) {
             layer->slices.simplify(distance);
+            layer->clear_slices_edge_grid();
             for (LayerRegion *layerm : layer->regions())
                 layerm->slices.simplify(distance);
         }
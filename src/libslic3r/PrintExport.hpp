@@ -5,6 +5,10 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <cstdio>
 
 #include <boost/log/trivial.hpp>
 
@@ -95,23 +99,51 @@ public:
 
 // Implementation for PNG raster output
 // Be aware that if a large number of layers are allocated, it can very well
-// exhaust the available memory especially on 32 bit platform.
+// exhaust the available memory especially on 32 bit platform. To avoid that,
+// the finished layers can be spooled into a temporary file (see spool()).
 template<> class FilePrinter<FilePrinterFormat::SLA_PNGZIP>
 {
     struct Layer {
         Raster first;
-        std::stringstream second;
+        std::string second;
 
         Layer() {}
 
         Layer(const Layer&) = delete;
         Layer(Layer&& m):
-            first(std::move(m.first))/*, second(std::move(m.second))*/ {}
+            first(std::move(m.first)), second(std::move(m.second)) {}
     };
 
-    // We will save the compressed PNG data into stringstreams which can be done
+    // Position of a spooled PNG image inside the spool file.
+    struct SpoolEntry {
+        std::streamoff offset = 0;
+        size_t         size   = 0;
+    };
+
+    // We will save the compressed PNG data into strings which can be done
     // in parallel. Later we can write every layer to the disk sequentially.
     std::vector<Layer> m_layers_rst;
+
+    // Ordered completion queue of the spooled layers. The layers are finished
+    // in parallel in an arbitrary order, but they are appended to the spool
+    // file only after all the preceding layers were appended, therefore the
+    // spool file is written sequentially and only the PNG images finished out
+    // of order are kept in memory.
+    std::string                    m_spool_path;
+    std::unique_ptr<std::fstream>  m_spool;
+    std::vector<SpoolEntry>        m_spool_index;
+    std::vector<bool>              m_spool_finished;
+    size_t                         m_spool_next = 0;
+    std::streamoff                 m_spool_size = 0;
+    bool                           m_spool_failed = false;
+    std::unique_ptr<std::mutex>    m_spool_mutex { new std::mutex };
+
+    // Rasters of the finished layers, which can be reused for the next
+    // layers. Only as many rasters are allocated as many layers are drawn
+    // at the same time.
+    std::vector<Raster>            m_raster_pool;
+    std::unique_ptr<std::mutex>    m_raster_pool_mutex { new std::mutex };
+
     Raster::Resolution m_res;
     Raster::PixelDim m_pxdim;
     double m_exp_time_s = .0, m_exp_time_first_s = .0;
@@ -187,8 +219,46 @@ public:
     FilePrinter(const FilePrinter& ) = delete;
     FilePrinter(FilePrinter&& m):
         m_layers_rst(std::move(m.m_layers_rst)),
+        m_spool_path(std::move(m.m_spool_path)),
+        m_spool(std::move(m.m_spool)),
+        m_spool_index(std::move(m.m_spool_index)),
+        m_spool_finished(std::move(m.m_spool_finished)),
+        m_spool_next(m.m_spool_next),
+        m_spool_size(m.m_spool_size),
+        m_spool_failed(m.m_spool_failed),
+        m_spool_mutex(std::move(m.m_spool_mutex)),
+        m_raster_pool(std::move(m.m_raster_pool)),
+        m_raster_pool_mutex(std::move(m.m_raster_pool_mutex)),
         m_res(m.m_res),
-        m_pxdim(m.m_pxdim) {}
+        m_pxdim(m.m_pxdim) { m.m_spool_path.clear(); }
+
+    ~FilePrinter() {
+        if(m_spool) {
+            m_spool.reset();
+            std::remove(m_spool_path.c_str());
+        }
+    }
+
+    /* Spool the finished layers into a temporary file at the given path
+     * instead of keeping all of them in memory until save() is called. The
+     * file is removed when the printer is destroyed. Has to be called before
+     * the first layer is finished.
+     */
+    inline void spool(const std::string& path) {
+        assert(!m_spool);
+        m_spool.reset(new std::fstream(path, std::fstream::in |
+                                             std::fstream::out |
+                                             std::fstream::trunc |
+                                             std::fstream::binary));
+        if(!m_spool->good()) {
+            m_spool.reset();
+            throw std::runtime_error("Cannot create the layer spool file " +
+                                     path);
+        }
+        m_spool_path = path;
+    }
+
+    inline bool spooled() const { return bool(m_spool); }
 
     inline void layers(unsigned cnt) { if(cnt > 0) m_layers_rst.resize(cnt); }
     inline unsigned layers() const { return unsigned(m_layers_rst.size()); }
@@ -198,31 +268,105 @@ public:
         m_layers_rst[lyr].first.draw(p);
     }
 
+    // Draw the polygons transformed by tr while rasterizing them. If the
+    // layer is split into tiles, the tiles can be drawn concurrently (see
+    // Raster::draw()).
+    inline void draw_polygons(const ExPolygons& p, unsigned lyr,
+                              const Raster::Trafo& tr = Raster::Trafo(),
+                              unsigned tile = 0, unsigned tiles = 1) {
+        assert(lyr < m_layers_rst.size());
+        m_layers_rst[lyr].first.draw(p, tr, tile, tiles);
+    }
+
+    // Free the rasters kept for the reuse by the next layers.
+    inline void release_rasters() {
+        std::lock_guard<std::mutex> lck(*m_raster_pool_mutex);
+        std::vector<Raster>().swap(m_raster_pool);
+    }
+
     inline void begin_layer(unsigned lyr) {
         if(m_layers_rst.size() <= lyr) m_layers_rst.resize(lyr+1);
-        m_layers_rst[lyr].first.reset(m_res, m_pxdim, m_o);
+        m_layers_rst[lyr].first = take_raster();
     }
 
     inline void begin_layer() {
         m_layers_rst.emplace_back();
-        m_layers_rst.front().first.reset(m_res, m_pxdim, m_o);
+        m_layers_rst.front().first = take_raster();
     }
 
     inline void finish_layer(unsigned lyr_id) {
         assert(lyr_id < m_layers_rst.size());
-        m_layers_rst[lyr_id].first.save(m_layers_rst[lyr_id].second,
-                                       Raster::Compression::PNG);
-        m_layers_rst[lyr_id].first.reset();
+        std::stringstream png;
+        m_layers_rst[lyr_id].first.save(png, Raster::Compression::PNG);
+        give_back_raster(std::move(m_layers_rst[lyr_id].first));
+        m_layers_rst[lyr_id].second = png.str();
     }
 
     inline void finish_layer() {
-        if(!m_layers_rst.empty()) {
-            m_layers_rst.back().first.save(m_layers_rst.back().second,
-                                          Raster::Compression::PNG);
-            m_layers_rst.back().first.reset();
+        if(m_layers_rst.empty()) return;
+        auto lyr_id = unsigned(m_layers_rst.size() - 1);
+        finish_layer(lyr_id);
+        spool_layer(lyr_id);
+    }
+
+    // Mark the finished layer as ready to be spooled and append all the ready
+    // layers following the last appended one to the spool file, releasing
+    // their memory. Calling it in the layer order writes the layer right away,
+    // the finished layers are kept in memory until then. Does nothing if the
+    // layers are not spooled.
+    void spool_layer(unsigned lyr_id) {
+        if(!m_spool) return;
+        std::lock_guard<std::mutex> lck(*m_spool_mutex);
+        if(m_spool_finished.size() < m_layers_rst.size()) {
+            m_spool_finished.resize(m_layers_rst.size(), false);
+            m_spool_index.resize(m_layers_rst.size());
+        }
+        m_spool_finished[lyr_id] = true;
+
+        for(; !m_spool_failed && m_spool_next < m_spool_finished.size() &&
+              m_spool_finished[m_spool_next]; ++m_spool_next)
+        {
+            std::string& png = m_layers_rst[m_spool_next].second;
+            m_spool->seekp(m_spool_size);
+            m_spool->write(png.data(), std::streamsize(png.size()));
+            m_spool->flush();
+            if(!m_spool->good()) {
+                // Keep this and the following layers in memory, the layers
+                // spooled so far can still be read back.
+                BOOST_LOG_TRIVIAL(error)
+                        << "Cannot write the layer spool file " << m_spool_path
+                        << ", keeping the remaining layers in memory";
+                m_spool->clear();
+                m_spool_failed = true;
+                break;
+            }
+
+            SpoolEntry& e = m_spool_index[m_spool_next];
+            e.offset = m_spool_size;
+            e.size = png.size();
+            m_spool_size += std::streamoff(png.size());
+            std::string().swap(png);
         }
     }
 
+    // Returns the compressed PNG image of a finished layer, possibly reading
+    // it back from the spool file. Returns an empty string for a layer, which
+    // was not finished.
+    std::string layer_png(unsigned lyr) {
+        assert(lyr < m_layers_rst.size());
+        std::lock_guard<std::mutex> lck(*m_spool_mutex);
+        if(!m_spool || lyr >= m_spool_next) return m_layers_rst[lyr].second;
+
+        const SpoolEntry& e = m_spool_index[lyr];
+        std::string data(e.size, '\0');
+        m_spool->seekg(e.offset);
+        if(e.size > 0) m_spool->read(&data.front(), std::streamsize(e.size));
+        if(!m_spool->good())
+            throw std::runtime_error("Cannot read the layer spool file " +
+                                     m_spool_path);
+        return data;
+    }
+
     template<class LyrFmt>
     inline void save(const std::string& path) {
         try {
@@ -238,7 +382,9 @@ public:
 
             for(unsigned i = 0; i < m_layers_rst.size() && writer.is_ok(); i++)
             {
-                if(m_layers_rst[i].second.rdbuf()->in_avail() > 0) {
+                // With spooling, only a single layer is held in memory here.
+                std::string png = layer_png(i);
+                if(!png.empty()) {
                     char lyrnum[6];
                     std::sprintf(lyrnum, "%.5d", i);
                     auto zfilename = project + lyrnum + ".png";
@@ -246,10 +392,8 @@ public:
 
                     if(!writer.is_ok()) break;
 
-                    writer << m_layers_rst[i].second.str();
-                    // writer << m_layers_rst[i].second.rdbuf();
-                    // we can keep the date for later calls of this method
-                    //m_layers_rst[i].second.str("");
+                    // we can keep the data for later calls of this method
+                    writer << png;
                 }
             }
         } catch(std::exception& e) {
@@ -275,7 +419,31 @@ public:
         }
 
         out.close();
-        m_layers_rst[i].first.reset();
+        give_back_raster(std::move(m_layers_rst[i].first));
+    }
+
+private:
+
+    // Get a cleared raster for a new layer, reusing a pooled one if possible.
+    Raster take_raster() {
+        Raster r;
+        {
+            std::lock_guard<std::mutex> lck(*m_raster_pool_mutex);
+            if(!m_raster_pool.empty()) {
+                r = std::move(m_raster_pool.back());
+                m_raster_pool.pop_back();
+            }
+        }
+
+        if(r.resolution().pixels() > 0) r.clear();
+        else r.reset(m_res, m_pxdim, m_o);
+
+        return r;
+    }
+
+    void give_back_raster(Raster&& r) {
+        std::lock_guard<std::mutex> lck(*m_raster_pool_mutex);
+        m_raster_pool.emplace_back(std::move(r));
     }
 };
 
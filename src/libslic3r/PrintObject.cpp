@@ -1747,6 +1747,7 @@ void PrintObject::_simplify_slices(double distance)
                 for (size_t region_idx = 0; region_idx < layer->m_regions.size(); ++ region_idx)
                     layer->m_regions[region_idx]->slices.simplify(distance);
                 layer->slices.simplify(distance);
+                layer->clear_slices_edge_grid();
             }
         });
     BOOST_LOG_TRIVIAL(debug) << "Slicing objects - siplifying slices in parallel - end";
@@ -1,7 +1,11 @@
 #include "Rasterizer.hpp"
 #include <ExPolygon.hpp>
+#include <BoundingBox.hpp>
 
 #include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
 
 // For rasterizing
 #include <agg/agg_basics.h>
@@ -13,13 +17,35 @@
 
 #include <agg/agg_scanline_p.h>
 #include <agg/agg_rasterizer_scanline_aa.h>
-#include <agg/agg_path_storage.h>
+#include <agg/agg_conv_transform.h>
+#include <agg/agg_trans_affine.h>
 
 // For png compression
 #include <png/writer.hpp>
 
 namespace Slic3r {
 
+// AGG vertex source reading the points of a polygon in place, so the polygon
+// does not have to be converted to an agg::path_storage before drawing.
+class PolygonSource {
+    const Polygon *m_poly = nullptr;
+    size_t m_idx = 0;
+public:
+    inline void attach(const Polygon& poly) { m_poly = &poly; m_idx = 0; }
+
+    inline void rewind(unsigned /*path_id*/) { m_idx = 0; }
+
+    inline unsigned vertex(double* x, double* y) {
+        const Points& pts = m_poly->points;
+        if(pts.empty() || m_idx > pts.size()) return agg::path_cmd_stop;
+
+        // The contour is closed by a line to the first point.
+        const Point& p = pts[m_idx < pts.size() ? m_idx : 0];
+        *x = double(p(0)); *y = double(p(1));
+        return m_idx++ == 0 ? agg::path_cmd_move_to : agg::path_cmd_line_to;
+    }
+};
+
 class Raster::Impl {
 public:
     using TPixelRenderer = agg::pixfmt_gray8; // agg::pixfmt_rgb24;
@@ -37,6 +63,15 @@ public:
     using Origin = Raster::Origin;
 
 private:
+
+    // The scan converter and the scanline storage. Both of them allocate
+    // their cell blocks on the first use, so they are kept for the next
+    // polygons.
+    struct ScanConverter {
+        agg::rasterizer_scanline_aa<> ras;
+        agg::scanline_p8 scanlines;
+    };
+
     Raster::Resolution m_resolution;
     Raster::PixelDim m_pxdim;
     TBuffer m_buf;
@@ -44,12 +79,9 @@ private:
     TPixelRenderer m_pixfmt;
     TRawRenderer m_raw_renderer;
     TRendererAA m_renderer;
+    ScanConverter m_sc;
     Origin m_o;
 
-    inline void flipy(agg::path_storage& path) const {
-        path.flip_y(0, m_resolution.height_px);
-    }
-
 public:
 
     inline Impl(const Raster::Resolution& res, const Raster::PixelDim &pd,
@@ -72,23 +104,63 @@ public:
         clear();
     }
 
-    void draw(const ExPolygon &poly) {
-        agg::rasterizer_scanline_aa<> ras;
-        agg::scanline_p8 scanlines;
-
-        auto&& path = to_path(poly.contour);
-
-        if(m_o == Origin::TOP_LEFT) flipy(path);
+    void draw(const ExPolygon &poly, const Raster::Trafo& tr) {
+        agg::trans_affine mtx = to_pixels(tr);
+        draw(poly, mtx, m_sc, m_renderer);
+    }
 
-        ras.add_path(path);
+    void draw(const ExPolygons &polys, const Raster::Trafo& tr,
+              unsigned tile, unsigned tiles)
+    {
+        agg::trans_affine mtx = to_pixels(tr);
 
-        for(auto h : poly.holes) {
-            auto&& holepath = to_path(h);
-            if(m_o == Origin::TOP_LEFT) flipy(holepath);
-            ras.add_path(holepath);
+        if(tiles <= 1) {
+            for(const ExPolygon& poly : polys) draw(poly, mtx, m_sc, m_renderer);
+            return;
         }
 
-        agg::render_scanlines(ras, scanlines, m_renderer);
+        // The polygons are scan converted as a whole, only the sweep of the
+        // scanlines is restricted to the rows of the tile, so the tiles are
+        // rendered exactly as if the polygons were drawn at once. Clipping the
+        // polygons to the tile would shift the anti-aliased edges crossing
+        // the tile borders. Only the rows of the tile are written, so the
+        // tiles can be drawn concurrently.
+        unsigned w = m_resolution.width_px, h = m_resolution.height_px;
+        int y1 = int(size_t(h) * tile / tiles);
+        int y2 = int(size_t(h) * (tile + 1) / tiles);
+        if(y1 >= y2) return;
+
+        ScanConverter sc;
+        TRawRenderer raw_renderer(m_pixfmt);
+        raw_renderer.clip_box(0, y1, int(w) - 1, y2 - 1);
+        TRendererAA renderer(raw_renderer);
+        renderer.color(ColorWhite);
+
+        for(const ExPolygon& poly : polys) {
+            if(poly.contour.points.empty()) continue;
+
+            // Skip the polygons, which are surely out of the tile. The
+            // transformed bounding box of the contour is conservative.
+            double ymin = std::numeric_limits<double>::max(), ymax = -ymin;
+            BoundingBox bb(poly.contour.points);
+            for(const Point& corner : { bb.min, bb.max, Point(bb.min(0), bb.max(1)),
+                                        Point(bb.max(0), bb.min(1)) }) {
+                double x = double(corner(0)), y = double(corner(1));
+                mtx.transform(&x, &y);
+                ymin = std::min(ymin, y); ymax = std::max(ymax, y);
+            }
+            if(ymax < y1 - 1 || ymin > y2 + 1) continue;
+
+            add_paths(poly, mtx, sc);
+
+            if(sc.ras.navigate_scanline(std::max(y1, sc.ras.min_y()))) {
+                sc.scanlines.reset(sc.ras.min_x(), sc.ras.max_x());
+                renderer.prepare();
+                while(sc.ras.sweep_scanline(sc.scanlines) &&
+                      sc.scanlines.y() < y2)
+                    renderer.render(sc.scanlines);
+            }
+        }
     }
 
     inline void clear() {
@@ -102,25 +174,54 @@ public:
     inline Origin origin() const /*noexcept*/ { return m_o; }
 
 private:
-    double getPx(const Point& p) {
-        return p(0) * SCALING_FACTOR/m_pxdim.w_mm;
+
+    static void add_paths(const ExPolygon &poly, agg::trans_affine& mtx,
+                          ScanConverter& sc)
+    {
+        PolygonSource src;
+        agg::conv_transform<PolygonSource> path(src, mtx);
+
+        sc.ras.reset();
+
+        src.attach(poly.contour);
+        sc.ras.add_path(path);
+
+        for(auto& h : poly.holes) {
+            src.attach(h);
+            sc.ras.add_path(path);
+        }
     }
 
-    double getPy(const Point& p) {
-        return p(1) * SCALING_FACTOR/m_pxdim.h_mm;
+    static void draw(const ExPolygon &poly, agg::trans_affine& mtx,
+                     ScanConverter& sc, TRendererAA& renderer)
+    {
+        add_paths(poly, mtx, sc);
+        agg::render_scanlines(sc.ras, sc.scanlines, renderer);
     }
 
-    agg::path_storage to_path(const Polygon& poly) {
-        agg::path_storage path;
-        auto it = poly.points.begin();
-        path.move_to(getPx(*it), getPy(*it));
-        while(++it != poly.points.end())
-            path.line_to(getPx(*it), getPy(*it));
+    // The transformation from the scaled coordinates of the input polygons
+    // to pixels, including the transformation of the drawn instance and the
+    // flipping of the Y axis. The matrix is composed by hand, the multiply()
+    // method of agg::trans_affine is not compiled in.
+    agg::trans_affine to_pixels(const Raster::Trafo& tr) const {
+        double c = std::cos(tr.rotation), s = std::sin(tr.rotation);
+        double kx = SCALING_FACTOR/m_pxdim.w_mm;
+        double ky = SCALING_FACTOR/m_pxdim.h_mm;
+
+        // Rows of the rotation and translation, x' = a*x + b*y + t
+        double ax = c, bx = -s, tx = tr.shift_x;
+        double ay = s, by = c,  ty = tr.shift_y;
+        if(tr.swap_xy) { std::swap(ax, ay); std::swap(bx, by); std::swap(tx, ty); }
+
+        ax *= kx; bx *= kx; tx *= kx;
+        ay *= ky; by *= ky; ty *= ky;
+
+        if(m_o == Origin::TOP_LEFT) {
+            ay = -ay; by = -by; ty = m_resolution.height_px - ty;
+        }
 
-        path.line_to(getPx(poly.points.front()), getPy(poly.points.front()));
-        return path;
+        return agg::trans_affine(ax, ay, bx, by, tx, ty);
     }
-
 };
 
 const Raster::Impl::TPixel Raster::Impl::ColorWhite = Raster::Impl::TPixel(255);
@@ -136,6 +237,12 @@ Raster::~Raster() {}
 Raster::Raster(Raster &&m):
     m_impl(std::move(m.m_impl)) {}
 
+Raster &Raster::operator=(Raster &&m)
+{
+    m_impl = std::move(m.m_impl);
+    return *this;
+}
+
 void Raster::reset(const Raster::Resolution &r, const Raster::PixelDim &pd)
 {
     // Free up the unnecessary memory and make sure it stays clear after
@@ -169,10 +276,18 @@ void Raster::clear()
     m_impl->clear();
 }
 
-void Raster::draw(const ExPolygon &poly)
+void Raster::draw(const ExPolygon &poly, const Trafo &tr)
+{
+    assert(m_impl);
+    m_impl->draw(poly, tr);
+}
+
+void Raster::draw(const ExPolygons &polys, const Trafo &tr,
+                  unsigned tile, unsigned tiles)
 {
     assert(m_impl);
-    m_impl->draw(poly);
+    assert(tile < tiles || tiles == 0);
+    m_impl->draw(polys, tr, tile, tiles);
 }
 
 void Raster::save(std::ostream& stream, Compression comp)
@@ -3,10 +3,12 @@
 
 #include <ostream>
 #include <memory>
+#include <vector>
 
 namespace Slic3r {
 
 class ExPolygon;
+typedef std::vector<ExPolygon> ExPolygons;
 
 /**
  * @brief Raster captures an anti-aliased monochrome canvas where vectorial
@@ -57,6 +59,21 @@ public:
             w_mm(px_width_mm), h_mm(px_height_mm) {}
     };
 
+    /// Transformation of the drawn polygons, which is applied while the
+    /// polygons are scan converted, so the polygons need not be copied. The
+    /// polygons are rotated around the origin first, then translated (in
+    /// scaled coordinates) and finally their X and Y coordinates may be
+    /// swapped.
+    struct Trafo {
+        double rotation;
+        double shift_x;
+        double shift_y;
+        bool swap_xy;
+        inline Trafo(double rot = 0., double sx = 0., double sy = 0.,
+                     bool swp = false):
+            rotation(rot), shift_x(sx), shift_y(sy), swap_xy(swp) {}
+    };
+
     /// Constructor taking the resolution and the pixel dimension.
     explicit Raster(const Resolution& r, const PixelDim& pd,
                     Origin o = Origin::BOTTOM_LEFT );
@@ -64,6 +81,7 @@ public:
     Raster(const Raster& cpy) = delete;
     Raster& operator=(const Raster& cpy) = delete;
     Raster(Raster&& m);
+    Raster& operator=(Raster&& m);
     ~Raster();
 
     /// Reallocated everything for the given resolution and pixel dimension.
@@ -83,7 +101,16 @@ public:
     void clear();
 
     /// Draw a polygon with holes.
-    void draw(const ExPolygon& poly);
+    void draw(const ExPolygon& poly, const Trafo& tr = Trafo());
+
+    /**
+     * Draw polygons with holes, all of them transformed by tr. The raster can
+     * be split into a number of horizontal bands (tiles) and only the tile-th
+     * of them is drawn. Different tiles of the same raster can be drawn
+     * concurrently, which helps with a single huge layer.
+     */
+    void draw(const ExPolygons& polys, const Trafo& tr = Trafo(),
+              unsigned tile = 0, unsigned tiles = 1);
 
     /// Save the raster on the specified stream.
     void save(std::ostream& stream, Compression comp = Compression::RAW);
@@ -15,7 +15,7 @@ namespace Slic3r {
 
 SLAAutoSupports::SLAAutoSupports(const TriangleMesh& mesh, const sla::EigenMesh3D& emesh, const std::vector<ExPolygons>& slices, const std::vector<float>& heights, 
     const Config& config, std::function<void(void)> throw_on_cancel)
-: m_config(config), m_V(emesh.V()), m_F(emesh.F()), m_throw_on_cancel(throw_on_cancel)
+: m_config(config), m_throw_on_cancel(throw_on_cancel), m_V(emesh.V()), m_F(emesh.F()), m_emesh(emesh)
 {
     // FIXME: It might be safer to get rid of the rand() calls altogether, because it is probably
     // not always thread-safe and can be slow if it is.
@@ -321,14 +321,14 @@ HOLE_HIT:
 
 void SLAAutoSupports::project_upward_onto_mesh(std::vector<Vec3d>& points) const
 {
-    Vec3f dir(0., 0., 1.);
-    igl::Hit hit{0, 0, 0.f, 0.f, 0.f};
-    for (Vec3d& p : points) {
-        igl::ray_mesh_intersect(p.cast<float>(), dir, m_V, m_F, hit);
-        int fid = hit.id;
-        Vec3f bc(1-hit.u-hit.v, hit.u, hit.v);
-        p = (bc(0) * m_V.row(m_F(fid, 0)) + bc(1) * m_V.row(m_F(fid, 1)) + bc(2)*m_V.row(m_F(fid, 2))).cast<double>();
-    }
+    // The rays are cast in one batch using the AABB tree of the mesh, which is shared with the support tree generation.
+    // The hit point is the source moved up by the hit distance, calculated in double precision. A point whose ray
+    // misses the mesh is left where it is.
+    std::vector<Vec3d> dirs(points.size(), Vec3d(0., 0., 1.));
+    std::vector<sla::EigenMesh3D::hit_result> hits = m_emesh.query_ray_hits(points, dirs);
+    for (size_t i = 0; i < points.size(); ++ i)
+        if (hits[i].face() >= 0)
+            points[i](2) += hits[i].distance();
 }
 
 
@@ -1,10 +1,11 @@
 #include <limits>
 #include <exception>
 
+#include <tbb/parallel_for.h>
+
 #include <libnest2d/optimizers/nlopt/genetic.hpp>
 #include "SLABoilerPlate.hpp"
 #include "SLARotfinder.hpp"
-#include "SLASupportTree.hpp"
 #include "Model.hpp"
 
 namespace Slic3r {
@@ -26,12 +27,34 @@ std::array<double, 3> find_best_rotation(const ModelObject& modelobj,
     // return value
     std::array<double, 3> rot;
 
-    // We will use only one instance of this converted mesh to examine different
-    // rotations
-    EigenMesh3D emesh(modelobj.raw_mesh());
+    // The objective function only depends on the directions of the faces,
+    // so the normals are calculated once here. They are stored column-wise
+    // (one contiguous array for each coordinate) so that the scoring below
+    // can be evaluated with Eigen's vectorized array expressions.
+    const TriangleMesh mesh = modelobj.raw_mesh();
+    const size_t       facets = size_t(mesh.stl.stats.number_of_facets);
+    Eigen::Matrix<double, Eigen::Dynamic, 3> normals(facets, 3);
+    for(size_t i = 0; i < facets; i++) {
+        const stl_facet& facet = mesh.stl.facet_start[i];
+        Vec3d p1 = facet.vertex[0].cast<double>();
+        Vec3d p2 = facet.vertex[1].cast<double>();
+        Vec3d p3 = facet.vertex[2].cast<double>();
+
+        Vec3d n = (p2 - p1).cross(p3 - p1);
+        double l = n.norm();
+        if(l > 0) n /= l;
+        normals.row(i) = n.transpose();
+    }
+
+    // The faces are scored in blocks of a fixed size, in parallel. The
+    // partial sums are added up in the order of the blocks, so the score
+    // does not depend on the scheduling of the threads.
+    static const size_t BLOCK_SIZE = 16384;
+    const size_t blocks = (facets + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    std::vector<double> partial_scores(blocks);
 
     // For current iteration number
-    unsigned status = 0;
+    unsigned status = 0, last_status = 0;
 
     // The maximum number of iterations
     auto max_tries = unsigned(accuracy * MAX_TRIES);
@@ -40,15 +63,13 @@ std::array<double, 3> find_best_rotation(const ModelObject& modelobj,
     statuscb(status);
 
     // So this is the object function which is called by the solver many times
-    // It has to yield a single value representing the current score. We will
-    // call the status callback in each iteration but the actual value may be
-    // the same for subsequent iterations (status goes from 0 to 100 but
-    // iterations can be many more)
-    auto objfunc = [&emesh, &status, &statuscb, max_tries]
+    // It has to yield a single value representing the current score. The
+    // status callback is only called if the reported percentage changes
+    // (status goes from 0 to 100 but iterations can be many more)
+    auto objfunc = [&normals, &partial_scores, facets, blocks,
+                    &status, &last_status, &statuscb, max_tries]
             (double rx, double ry, double rz)
     {
-        EigenMesh3D& m = emesh;
-
         // prepare the rotation transformation
         Transform3d rt = Transform3d::Identity();
 
@@ -56,11 +77,13 @@ std::array<double, 3> find_best_rotation(const ModelObject& modelobj,
         rt.rotate(Eigen::AngleAxisd(ry, Vec3d::UnitY()));
         rt.rotate(Eigen::AngleAxisd(rx, Vec3d::UnitX()));
 
-        double score = 0;
+        const Eigen::Matrix3d r = rt.linear();
 
-        // For all triangles we calculate the normal and sum up the dot product
-        // (a scalar indicating how much are two vectors aligned) with each axis
-        // this will result in a value that is greater if a normal is aligned
+        // For all triangles we rotate the normal with the current rotation
+        // given by the solver and sum up the dot product (a scalar indicating
+        // how much are two vectors aligned) with each axis. The dot product of
+        // the rotated normal with an axis is simply the respective coordinate.
+        // This will result in a value that is greater if a normal is aligned
         // with all axes. If the normal is aligned than the triangle itself is
         // orthogonal to the axes and that is good for print quality.
 
@@ -68,30 +91,32 @@ std::array<double, 3> find_best_rotation(const ModelObject& modelobj,
         // area. The current function is only an example of how to optimize.
 
         // Later we can add more criteria like the number of overhangs, etc...
-        for(int i = 0; i < m.F().rows(); i++) {
-            auto idx = m.F().row(i);
-
-            Vec3d p1 = m.V().row(idx(0));
-            Vec3d p2 = m.V().row(idx(1));
-            Vec3d p3 = m.V().row(idx(2));
+        auto score_block = [&normals, &partial_scores, &r, facets]
+                (size_t blk)
+        {
+            size_t from = blk * BLOCK_SIZE;
+            auto   len  = Eigen::Index(std::min(BLOCK_SIZE, facets - from));
+            auto   nx   = normals.col(X).segment(Eigen::Index(from), len).array();
+            auto   ny   = normals.col(Y).segment(Eigen::Index(from), len).array();
+            auto   nz   = normals.col(Z).segment(Eigen::Index(from), len).array();
+
+            partial_scores[blk] =
+                    (r(0, 0) * nx + r(0, 1) * ny + r(0, 2) * nz).abs().sum() +
+                    (r(1, 0) * nx + r(1, 1) * ny + r(1, 2) * nz).abs().sum() +
+                    (r(2, 0) * nx + r(2, 1) * ny + r(2, 2) * nz).abs().sum();
+        };
+
+        if(blocks > 1)
+            tbb::parallel_for(size_t(0), blocks, score_block);
+        else if(blocks == 1)
+            score_block(0);
 
-            Eigen::Vector3d U = p2 - p1;
-            Eigen::Vector3d V = p3 - p1;
-
-            // So this is the normal
-            auto n = U.cross(V).normalized();
-
-            // rotate the normal with the current rotation given by the solver
-            n = rt * n;
-
-            // We should score against the alignment with the reference planes
-            score += std::abs(n.dot(Vec3d::UnitX()));
-            score += std::abs(n.dot(Vec3d::UnitY()));
-            score += std::abs(n.dot(Vec3d::UnitZ()));
-        }
+        double score = 0;
+        for(double s : partial_scores) score += s;
 
         // report status
-        statuscb( unsigned(++status * 100.0/max_tries) );
+        unsigned st = unsigned(++status * 100.0/max_tries);
+        if(st != last_status) statuscb(last_status = st);
 
         return score;
     };
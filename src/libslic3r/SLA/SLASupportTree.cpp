@@ -4,6 +4,7 @@
  */
 
 #include <numeric>
+#include <unordered_map>
 #include "SLASupportTree.hpp"
 #include "SLABoilerPlate.hpp"
 #include "SLASpatIndex.hpp"
@@ -568,6 +569,52 @@ inline double ray_mesh_intersect(const Vec3d& s,
     return m.query_ray_hit(s, dir).distance();
 }
 
+// Cast a fan of rays on the mesh in one batch and return the smallest hit
+// distance. The rays start at the safety distance from the points in srcs. If
+// ins_check is true, the rays starting inside the model are re-cast from the
+// outside of the object unless they would travel a longer distance than
+// max_inside inside the model.
+double mesh_intersect_fan(const std::vector<Vec3d>& srcs,
+                          const std::vector<Vec3d>& dirs,
+                          double max_inside,
+                          double safety_distance,
+                          const EigenMesh3D& m,
+                          bool ins_check)
+{
+    const double& sd = safety_distance;
+
+    std::vector<Vec3d> starts(srcs.size());
+    for(size_t i = 0; i < srcs.size(); ++i) starts[i] = srcs[i] + sd*dirs[i];
+
+    auto hits = m.query_ray_hits(starts, dirs);
+
+    std::vector<double> dists(hits.size());
+    std::vector<Vec3d> resrcs, redirs;
+    std::vector<size_t> reidx;
+    for(size_t i = 0; i < hits.size(); ++i) {
+        auto& hr = hits[i];
+        if(ins_check && hr.is_inside()) { // the hit is inside the model
+            if(hr.distance() > max_inside) dists[i] = 0;
+            else {
+                // re-cast the ray from the outside of the object
+                resrcs.emplace_back(srcs[i] + (hr.distance() + 2*sd)*dirs[i]);
+                redirs.emplace_back(dirs[i]);
+                reidx.emplace_back(i);
+            }
+        } else dists[i] = hr.distance();
+    }
+
+    if(!reidx.empty()) {
+        auto hits2 = m.query_ray_hits(resrcs, redirs);
+        for(size_t i = 0; i < reidx.size(); ++i)
+            dists[reidx[i]] = hits2[i].distance();
+    }
+
+    auto mit = std::min_element(dists.begin(), dists.end());
+
+    return *mit;
+}
+
 // This function will test if a future pinhead would not collide with the model
 // geometry. It does not take a 'Head' object because those are created after
 // this test.
@@ -622,10 +669,11 @@ double pinhead_mesh_intersect(const Vec3d& s,
     // they define the plane where we have to iterate with the given angles
     // in the 'phis' vector
 
-    tbb::parallel_for(size_t(0), phis.size(),
-                      [&phis, &m, sd, r_pin, r_back, s, a, b, c](size_t i)
-    {
-        double& phi = phis[i];
+    // The rays are cast in one batch so they are traced through the mesh
+    // together. The callers are parallelized over the support points.
+    std::vector<Vec3d> srcs(phis.size()), dirs(phis.size());
+    for(size_t i = 0; i < phis.size(); ++i) {
+        double phi = phis[i];
         double sinphi = std::sin(phi);
         double cosphi = std::cos(phi);
 
@@ -654,21 +702,11 @@ double pinhead_mesh_intersect(const Vec3d& s,
 //        phi = m.query_ray_hit(psq.point_on_mesh() + sd*n, n);
 
         Vec3d n = (p - ps).normalized();
-        auto hr = m.query_ray_hit(ps + sd*n, n);
-
-        if(hr.is_inside()) { // the hit is inside the model
-            if(hr.distance() > 2*r_pin) phi = 0;
-            else {
-                // re-cast the ray from the outside of the object
-                auto hr2 = m.query_ray_hit(ps + (hr.distance() + 2*sd)*n, n);
-                phi = hr2.distance();
-            }
-        } else phi = hr.distance();
-    });
-
-    auto mit = std::min_element(phis.begin(), phis.end());
+        srcs[i] = ps;
+        dirs[i] = n;
+    }
 
-    return *mit;
+    return mesh_intersect_fan(srcs, dirs, 2*r_pin, sd, m, true);
 }
 
 // Checking bridge (pillar and stick as well) intersection with the model. If
@@ -693,10 +731,9 @@ double bridge_mesh_intersect(const Vec3d& s,
     std::vector<double> phis(samples);
     for(size_t i = 0; i < phis.size(); ++i) phis[i] = i*2*PI/phis.size();
 
-    tbb::parallel_for(size_t(0), phis.size(),
-                      [&phis, &m, a, b, sd, dir, r, s, ins_check](size_t i)
-    {
-        double& phi = phis[i];
+    std::vector<Vec3d> srcs(phis.size()), dirs(phis.size(), dir);
+    for(size_t i = 0; i < phis.size(); ++i) {
+        double phi = phis[i];
         double sinphi = std::sin(phi);
         double cosphi = std::cos(phi);
 
@@ -709,21 +746,10 @@ double bridge_mesh_intersect(const Vec3d& s,
                  s(Y) + rcos * a(Y) + rsin * b(Y),
                  s(Z) + rcos * a(Z) + rsin * b(Z));
 
-        auto hr = m.query_ray_hit(p + sd*dir, dir);
-
-        if(ins_check && hr.is_inside()) {
-            if(hr.distance() > 2*r) phi = 0;
-            else {
-                // re-cast the ray from the outside of the object
-                auto hr2 = m.query_ray_hit(p + (hr.distance() + 2*sd)*dir, dir);
-                phi = hr2.distance();
-            }
-        } else phi = hr.distance();
-    });
-
-    auto mit = std::min_element(phis.begin(), phis.end());
+        srcs[i] = p;
+    }
 
-    return *mit;
+    return mesh_intersect_fan(srcs, dirs, 2*r, sd, m, ins_check);
 }
 
 PointSet normals(const PointSet& points, const EigenMesh3D& mesh,
@@ -1090,17 +1116,119 @@ Vec3d dirv(const Vec3d& startp, const Vec3d& endp) {
     return (endp - startp).normalized();
 }
 
+// The fate of a support point decided by the filtering step
+enum SupportPointType { sptDiscarded, sptHead, sptHeadless };
+
+// A bridge stick between two pillars, to be added to the result.
+struct BridgeStick { Vec3d sj, ej; double r; };
+using BridgeSticks = std::vector<BridgeStick>;
+
+// The key of the cached values is made of the exact coordinates of the
+// support points (or pillar ends) the values were computed for.
+template<size_t N> using CacheKey = std::array<double, N>;
+
+struct CacheKeyHash {
+    template<size_t N> size_t operator()(const CacheKey<N>& key) const {
+        size_t seed = 0;
+        std::hash<double> hasher;
+        for(double v : key)
+            seed ^= hasher(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        return seed;
+    }
+};
+
+inline CacheKey<3> point_key(const Vec3d& p) { return {p(X), p(Y), p(Z)}; }
+
+bool operator==(const SupportConfig& c1, const SupportConfig& c2) {
+    return c1.head_front_radius_mm == c2.head_front_radius_mm &&
+           c1.head_penetration_mm == c2.head_penetration_mm &&
+           c1.head_back_radius_mm == c2.head_back_radius_mm &&
+           c1.head_width_mm == c2.head_width_mm &&
+           c1.headless_pillar_radius_mm == c2.headless_pillar_radius_mm &&
+           c1.pillar_connection_mode == c2.pillar_connection_mode &&
+           c1.ground_facing_only == c2.ground_facing_only &&
+           c1.pillar_widening_factor == c2.pillar_widening_factor &&
+           c1.base_radius_mm == c2.base_radius_mm &&
+           c1.base_height_mm == c2.base_height_mm &&
+           c1.tilt == c2.tilt &&
+           c1.max_bridge_length_mm == c2.max_bridge_length_mm &&
+           c1.object_elevation_mm == c2.object_elevation_mm &&
+           c1.normal_cutoff_angle == c2.normal_cutoff_angle;
+}
+
+class SupportCache::Impl {
+public:
+    // Result of the filtering step for a support point: the type and the
+    // corrected normal of the head.
+    struct PointResult {
+        SupportPointType type;
+        Vec3d normal;
+    };
+
+    // Result of the classification of a head: whether a pillar can be
+    // deployed, the (adjusted) head width and the distance to the model
+    // surface below (or infinity if the pillar reaches the ground).
+    struct HeadResult {
+        bool accepted;
+        double width_mm;
+        double height;
+    };
+
+    // Result of the collision checks of a headless stick.
+    struct HeadlessResult {
+        double idist, dist;
+    };
+
+    template<class T, size_t N>
+    using Map = std::unordered_map<CacheKey<N>, T, CacheKeyHash>;
+
+    bool valid = false;
+    SupportConfig cfg;
+
+    Map<PointResult, 3>     points;
+    Map<HeadResult, 3>      heads;
+    Map<HeadlessResult, 3>  headless;
+
+    // The bridges between pillar pairs. The key consists of the junction
+    // points of the heads, the end points of the pillars and the radius.
+    Map<BridgeSticks, 13>   bridges;
+
+    template<class T, size_t N>
+    const T* find(const Map<T, N>& map, const CacheKey<N>& key) const {
+        if(!valid) return nullptr;
+        auto it = map.find(key);
+        return it == map.end() ? nullptr : &it->second;
+    }
+};
+
+SupportCache::SupportCache(): m_impl(new Impl()) {}
+SupportCache::SupportCache(SupportCache &&) = default;
+SupportCache &SupportCache::operator=(SupportCache &&) = default;
+SupportCache::~SupportCache() {}
+
+void SupportCache::clear() { m_impl.reset(new Impl()); }
+
 /// Generation of the supports, entry point function. This is called from the
 /// SLASupportTree constructor and throws an SLASupportsStoppedException if it
 /// gets canceled by the ctl object's stopcondition functor.
 bool SLASupportTree::generate(const PointSet &points,
                               const EigenMesh3D& mesh,
                               const SupportConfig &cfg,
-                              const Controller &ctl)
+                              const Controller &ctl,
+                              SupportCache *cache)
 {
     // If there are no input points there is no point in doing anything
     if(points.rows() == 0) return false;
 
+    // The results of the previous run are looked up in 'prevc', the results
+    // of this run are collected in 'nextc'. The cache is only updated if the
+    // generation finishes, so the entries of the removed support points are
+    // dropped and a canceled run leaves the cache intact.
+    SupportCache::Impl nocache;
+    if(cache && !(cache->m_impl->cfg == cfg)) cache->clear();
+    const SupportCache::Impl& prevc = cache ? *cache->m_impl : nocache;
+    SupportCache::Impl nextc;
+
     PointSet filtered_points;       // all valid support points
     PointSet head_positions;        // support points with pinhead
     PointSet head_normals;          // head normals
@@ -1158,7 +1286,7 @@ bool SLASupportTree::generate(const PointSet &points,
     // is applicable and adjust its angle at each support point.
     // We will also merge the support points that are just too close and can be
     // considered as one.
-    auto filterfn = [tifcl] (
+    auto filterfn = [tifcl, &prevc, &nextc] (
             const SupportConfig& cfg,
             const PointSet& points,
             const EigenMesh3D& mesh,
@@ -1187,8 +1315,29 @@ bool SLASupportTree::generate(const PointSet &points,
 
         tifcl();
 
-        // calculate the normals to the triangles belonging to filtered points
-        auto nmls = sla::normals(filt_pts, mesh, cfg.head_front_radius_mm, tifcl);
+        // Look up the points processed in the previous run. Only the new
+        // points need the normals and the pinhead collision checks.
+        std::vector<const SupportCache::Impl::PointResult*> cached(
+                    size_t(count), nullptr);
+        std::vector<long> nmlidx(size_t(count), -1);
+        long ncount = 0;
+        for(int i = 0; i < count; i++) {
+            cached[size_t(i)] = prevc.find(prevc.points,
+                                           point_key(filt_pts.row(i)));
+            if(!cached[size_t(i)]) nmlidx[size_t(i)] = ncount++;
+        }
+
+        PointSet new_pts(ncount, 3);
+        for(int i = 0; i < count; i++)
+            if(nmlidx[size_t(i)] >= 0)
+                new_pts.row(nmlidx[size_t(i)]) = filt_pts.row(i);
+
+        tifcl();
+
+        // calculate the normals to the triangles belonging to new points
+        PointSet nmls;
+        if(ncount > 0)
+            nmls = sla::normals(new_pts, mesh, cfg.head_front_radius_mm, tifcl);
 
         head_norm.resize(count, 3);
         head_pos.resize(count, 3);
@@ -1200,10 +1349,24 @@ bool SLASupportTree::generate(const PointSet &points,
         // not be enough space for the pinhead. Filtering is applied for
         // these reasons.
 
-        int pcount = 0, hlcount = 0;
-        for(int i = 0; i < count; i++) {
+        // The pinhead collision checks of the support points are independent
+        // of each other so they are done in parallel. The results are
+        // compacted afterwards in the original order of the points.
+        std::vector<SupportPointType> ptypes(size_t(count), sptDiscarded);
+        std::vector<Vec3d> pnormals(ptypes.size(), Vec3d::Zero());
+
+        tbb::parallel_for(size_t(0), size_t(count),
+                          [&tifcl, &cfg, &nmls, &filt_pts, &mesh, &cached,
+                           &nmlidx, &ptypes, &pnormals](size_t i)
+        {
             tifcl();
-            auto n = nmls.row(i);
+            if(cached[i]) {
+                ptypes[i] = cached[i]->type;
+                pnormals[i] = cached[i]->normal;
+                return;
+            }
+
+            auto n = nmls.row(nmlidx[i]);
 
             // for all normals we generate the spherical coordinates and
             // saturate the polar angle to 45 degrees from the bottom then
@@ -1231,7 +1394,7 @@ bool SLASupportTree::generate(const PointSet &points,
                 nn.normalize();
 
                 // save the head (pinpoint) position
-                Vec3d hp = filt_pts.row(i);
+                Vec3d hp = filt_pts.row(long(i));
 
                 // the full width of the head
                 double w = cfg.head_width_mm +
@@ -1248,20 +1411,34 @@ bool SLASupportTree::generate(const PointSet &points,
                             w,
                             mesh);
 
-                if(t > w || std::isinf(t)) {
-                    head_pos.row(pcount) = hp;
+                // save the verified and corrected normal
+                pnormals[i] = nn;
 
-                    // save the verified and corrected normal
-                    head_norm.row(pcount) = nn;
-
-                    ++pcount;
-                } else if( polar >= 3*PI/4 ) {
+                if(t > w || std::isinf(t)) ptypes[i] = sptHead;
+                else if( polar >= 3*PI/4 ) {
                     // Headless supports do not tilt like the headed ones so
                     // the normal should point almost to the ground.
-                    headless_norm.row(hlcount) = nn;
-                    headless_pos.row(hlcount++) = hp;
+                    ptypes[i] = sptHeadless;
                 }
             }
+        });
+
+        int pcount = 0, hlcount = 0;
+        for(int i = 0; i < count; i++) {
+            nextc.points[point_key(filt_pts.row(i))] =
+                    { ptypes[size_t(i)], pnormals[size_t(i)] };
+
+            switch(ptypes[size_t(i)]) {
+            case sptHead:
+                head_pos.row(pcount) = filt_pts.row(i);
+                head_norm.row(pcount++) = pnormals[size_t(i)];
+                break;
+            case sptHeadless:
+                headless_norm.row(hlcount) = pnormals[size_t(i)];
+                headless_pos.row(hlcount++) = filt_pts.row(i);
+                break;
+            case sptDiscarded: break;
+            }
         }
 
         head_pos.conservativeResize(pcount, Eigen::NoChange);
@@ -1304,7 +1481,7 @@ bool SLASupportTree::generate(const PointSet &points,
     // will process it. Also, the pillars will be grouped into clusters that can
     // be interconnected with bridges. Elements of these groups may or may not
     // be interconnected. Here we only run the clustering algorithm.
-    auto classifyfn = [tifcl] (
+    auto classifyfn = [tifcl, &prevc, &nextc] (
             const SupportConfig& cfg,
             const EigenMesh3D& mesh,
             PointSet& head_pos,
@@ -1327,9 +1504,43 @@ bool SLASupportTree::generate(const PointSet &points,
         // First we search decide which heads reach the ground and can be full
         // pillars and which shall be connected to the model surface (or search
         // a suitable path around the surface that leads to the ground -- TODO)
-        for(unsigned i = 0; i < head_pos.rows(); i++) {
+        // The pillar collision checks of the heads are done in parallel, the
+        // indices are collected afterwards in the original order.
+        std::vector<Head*> heads(size_t(head_pos.rows()));
+        for(size_t i = 0; i < heads.size(); ++i) heads[i] = &result.head(i);
+
+        std::vector<double> heights(heads.size());
+        std::vector<char> accepted(heads.size(), false);
+
+        // Regenerate the head geometry with the new width
+        auto rebuild_head = [](Head& head) {
+            auto id = head.id;
+            head = Head(head.r_back_mm,
+                        head.r_pin_mm,
+                        head.width_mm,
+                        head.penetration_mm,
+                        head.dir,
+                        head.tr);
+            head.id = id;
+        };
+
+        tbb::parallel_for(size_t(0), heads.size(),
+                          [&tifcl, &mesh, &heads, &heights, &accepted,
+                           &head_pos, &prevc, &rebuild_head]
+                          (size_t i)
+        {
             tifcl();
-            auto& head = result.head(i);
+            auto& head = *heads[i];
+
+            auto cached = prevc.find(prevc.heads,
+                                     point_key(head_pos.row(long(i))));
+            if(cached) {
+                head.width_mm = cached->width_mm;
+                if(cached->accepted) rebuild_head(head);
+                heights[i] = cached->height;
+                accepted[i] = cached->accepted;
+                return;
+            }
 
             Vec3d dir(0, 0, -1);
             bool accept = false;
@@ -1358,25 +1569,29 @@ bool SLASupportTree::generate(const PointSet &points,
                 } else {
                     accept = true; t = tprec;
 
-                    auto id = head.id;
                     // We need to regenerate the head geometry
-                    head = Head(head.r_back_mm,
-                                head.r_pin_mm,
-                                head.width_mm,
-                                head.penetration_mm,
-                                head.dir,
-                                head.tr);
-                    head.id = id;
+                    rebuild_head(head);
                 }
 
                 ri++;
             }
 
+            heights[i] = t;
+            accepted[i] = accept;
+        });
+
+        for(unsigned i = 0; i < heads.size(); i++) {
+            auto& head = *heads[i];
+            double t = heights[i];
+
+            nextc.heads[point_key(head_pos.row(i))] =
+                    { bool(accepted[i]), head.width_mm, t };
+
             // Save the distance from a surface in the Z axis downwards. It may
             // be infinity but that is telling us that it touches the ground.
             gndheight.emplace_back(t);
 
-            if(accept) {
+            if(accepted[i]) {
                 if(std::isinf(t)) gndidx.emplace_back(i);
                 else nogndidx.emplace_back(i);
             } else {
@@ -1419,12 +1634,14 @@ bool SLASupportTree::generate(const PointSet &points,
     };
 
     // Helper function for interconnecting two pillars with zig-zag bridges.
-    // This is not an individual step.
+    // This is not an individual step. The bridges are only collected so that
+    // many pillar pairs can be processed in parallel.
     auto interconnect = [&cfg](
             const Pillar& pillar,
             const Pillar& nextpillar,
             const EigenMesh3D& emesh,
-            Result& result)
+            const Result& result,
+            BridgeSticks& sticks)
     {
         const Head& phead = result.pillar_head(pillar.id);
         const Head& nextphead = result.pillar_head(nextpillar.id);
@@ -1448,7 +1665,7 @@ bool SLASupportTree::generate(const PointSet &points,
                   ej(Z) > nextpillar.endpoint(Z) + cfg.base_radius_mm)
         {
             if(chkd >= bridge_distance) {
-                result.add_bridge(sj, ej, pillar.r);
+                sticks.push_back({sj, ej, pillar.r});
 
                 auto pcm = cfg.pillar_connection_mode;
 
@@ -1470,7 +1687,7 @@ bool SLASupportTree::generate(const PointSet &points,
 
 
                     if(backchkd >= bridge_distance) {
-                        result.add_bridge(bsj, bej, pillar.r);
+                        sticks.push_back({bsj, bej, pillar.r});
                     }
                 }
             }
@@ -1480,12 +1697,54 @@ bool SLASupportTree::generate(const PointSet &points,
         }
     };
 
+    // Interconnect the pillar pairs in parallel. The bridges are added to the
+    // result in the order of the pairs, independently of the scheduling.
+    // The pairs which were interconnected in the previous run are taken
+    // from the cache.
+    using PillarPairs = std::vector<std::pair<const Pillar*, const Pillar*>>;
+    auto interconnect_pairs = [interconnect, tifcl, &prevc, &nextc](
+            const PillarPairs& pairs,
+            const EigenMesh3D& emesh,
+            Result& result)
+    {
+        std::vector<CacheKey<13>> keys; keys.reserve(pairs.size());
+        std::vector<const BridgeSticks*> cached(pairs.size(), nullptr);
+        for(size_t i = 0; i < pairs.size(); ++i) {
+            const Pillar& pillar = *pairs[i].first;
+            const Pillar& nextpillar = *pairs[i].second;
+            Vec3d sj = result.pillar_head(pillar.id).junction_point();
+            Vec3d nj = result.pillar_head(nextpillar.id).junction_point();
+            const Vec3d& se = pillar.endpoint;
+            const Vec3d& ne = nextpillar.endpoint;
+            keys.push_back({sj(X), sj(Y), sj(Z), nj(X), nj(Y), nj(Z),
+                            se(X), se(Y), se(Z), ne(X), ne(Y), ne(Z),
+                            pillar.r});
+            cached[i] = prevc.find(prevc.bridges, keys.back());
+        }
+
+        std::vector<BridgeSticks> sticks(pairs.size());
+        tbb::parallel_for(size_t(0), pairs.size(),
+                          [&interconnect, &tifcl, &pairs, &emesh, &result,
+                           &cached, &sticks](size_t i)
+        {
+            tifcl();
+            if(cached[i]) sticks[i] = *cached[i];
+            else interconnect(*pairs[i].first, *pairs[i].second, emesh,
+                              result, sticks[i]);
+        });
+
+        for(size_t i = 0; i < pairs.size(); ++i) {
+            for(auto& st : sticks[i]) result.add_bridge(st.sj, st.ej, st.r);
+            nextc.bridges[keys[i]] = std::move(sticks[i]);
+        }
+    };
+
     // Step: Routing the ground connected pinheads, and interconnecting them
     // with additional (angled) bridges. Not all of these pinheads will be
     // a full pillar (ground connected). Some will connect to a nearby pillar
     // using a bridge. The max number of such side-heads for a central pillar
     // is limited to avoid bad weight distribution.
-    auto routing_ground_fn = [gnd_head_pt, interconnect, tifcl](
+    auto routing_ground_fn = [gnd_head_pt, interconnect_pairs, tifcl](
             const SupportConfig& cfg,
             const ClusteredPoints& gnd_clusters,
             const IndexSet& gndidx,
@@ -1678,6 +1937,9 @@ bool SLASupportTree::generate(const PointSet &points,
                 return Vec2d(p(X), p(Y)); // project to 2D in along Z axis
             });
 
+            // The pillar pairs to interconnect in this iteration
+            PillarPairs pairs;
+
             if(!ring.empty()) {
                 // inner ring is now in 'newring' and outer ring is in 'ring'
                 SpatIndex innerring;
@@ -1697,7 +1959,7 @@ bool SLASupportTree::generate(const PointSet &points,
 
                     auto ne = res.front();
                     const Pillar& innerpill = result.pillars()[ne.second];
-                    interconnect(outerpill, innerpill, emesh, result);
+                    pairs.emplace_back(&outerpill, &innerpill);
                 }
             }
 
@@ -1719,9 +1981,11 @@ bool SLASupportTree::generate(const PointSet &points,
                 tifcl();
                 const Pillar& pillar = result.head_pillar(gndidx[*it]);
                 const Pillar& nextpillar = result.head_pillar(gndidx[*next]);
-                interconnect(pillar, nextpillar, emesh, result);
+                pairs.emplace_back(&pillar, &nextpillar);
             }
 
+            interconnect_pairs(pairs, emesh, result);
+
             auto sring = ring; ClusterEl tmp;
             std::sort(sring.begin(), sring.end());
             std::set_difference(rem.begin(), rem.end(),
@@ -1800,7 +2064,7 @@ bool SLASupportTree::generate(const PointSet &points,
     // Step: process the support points where there is not enough space for a
     // full pinhead. In this case we will use a rounded sphere as a touching
     // point and use a thinner bridge (let's call it a stick).
-    auto process_headless = [tifcl](
+    auto process_headless = [tifcl, &prevc, &nextc](
             const SupportConfig& cfg,
             const PointSet& headless_pts,
             const PointSet& headless_norm,
@@ -1813,6 +2077,31 @@ bool SLASupportTree::generate(const PointSet &points,
         const double R = cfg.headless_pillar_radius_mm;
         const double HWIDTH_MM = R/3;
 
+        // The collision checks of the sticks are done in parallel
+        std::vector<double> idists(size_t(headless_pts.rows()));
+        std::vector<double> dists(idists.size());
+        tbb::parallel_for(size_t(0), idists.size(),
+                          [&tifcl, &headless_pts, &headless_norm, &emesh,
+                           &prevc, &idists, &dists, R, HWIDTH_MM](size_t i)
+        {
+            tifcl();
+            Vec3d sph = headless_pts.row(long(i));
+            auto cached = prevc.find(prevc.headless, point_key(sph));
+            if(cached) {
+                idists[i] = cached->idist;
+                dists[i] = cached->dist;
+                return;
+            }
+
+            Vec3d n = headless_norm.row(long(i));
+            Vec3d sj = sph - n * HWIDTH_MM + R * n;
+            Vec3d dir = {0, 0, -1};
+
+            // This is only for checking
+            idists[i] = bridge_mesh_intersect(sph, dir, R, emesh, true);
+            dists[i] = ray_mesh_intersect(sj, dir, emesh);
+        });
+
         // We will sink the pins into the model surface for a distance of 1/3 of
         // the pin radius
         for(int i = 0; i < headless_pts.rows(); i++) { tifcl();
@@ -1823,9 +2112,9 @@ bool SLASupportTree::generate(const PointSet &points,
             Vec3d dir = {0, 0, -1};
             Vec3d sj = sp + R * n;              // stick start point
 
-            // This is only for checking
-            double idist = bridge_mesh_intersect(sph, dir, R, emesh, true);
-            double dist = ray_mesh_intersect(sj, dir, emesh);
+            double idist = idists[size_t(i)];
+            double dist = dists[size_t(i)];
+            nextc.headless[point_key(sph)] = { idist, dist };
 
             if(std::isinf(idist) || std::isnan(idist) || idist < 2*R ||
                std::isinf(dist)  || std::isnan(dist)   || dist < 2*R) {
@@ -1965,6 +2254,12 @@ bool SLASupportTree::generate(const PointSet &points,
 
     if(pc == ABORT) throw SLASupportsStoppedException();
 
+    if(cache) {
+        nextc.valid = true;
+        nextc.cfg = cfg;
+        *cache->m_impl = std::move(nextc);
+    }
+
     return pc == ABORT;
 }
 
@@ -2030,11 +2325,12 @@ void SLASupportTree::remove_pad()
 SLASupportTree::SLASupportTree(const PointSet &points,
                                const EigenMesh3D& emesh,
                                const SupportConfig &cfg,
-                               const Controller &ctl):
+                               const Controller &ctl,
+                               SupportCache *cache):
     m_impl(new Impl(ctl))
 {
     m_impl->ground_level = emesh.ground_level() - cfg.object_elevation_mm;
-    generate(points, emesh, cfg, ctl);
+    generate(points, emesh, cfg, ctl, cache);
 }
 
 SLASupportTree::SLASupportTree(const SLASupportTree &c):
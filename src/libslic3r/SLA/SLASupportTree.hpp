@@ -5,6 +5,7 @@
 #include <array>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <Eigen/Geometry>
 
 namespace Slic3r {
@@ -106,27 +107,39 @@ struct Controller {
 };
 
 /// An index-triangle structure for libIGL functions. Also serves as an
-/// alternative (raw) input format for the SLASupportTree
+/// alternative (raw) input format for the SLASupportTree.
+/// The mesh is immutable, copies of an EigenMesh3D share the mesh data and
+/// the acceleration structures. The AABB tree and the winding number tree are
+/// only built when the first query needing them is made.
 class EigenMesh3D {
     class AABBImpl;
+    class WindTreeImpl;
 
-    Eigen::MatrixXd m_V;
-    Eigen::MatrixXi m_F;
-    double m_ground_level = 0;
+    struct Data {
+        Eigen::MatrixXd V;
+        Eigen::MatrixXi F;
+        double ground_level = 0;
 
-    std::unique_ptr<AABBImpl> m_aabb;
+        mutable std::once_flag aabb_flag, windtree_flag;
+        mutable std::unique_ptr<AABBImpl> aabb;
+        mutable std::unique_ptr<WindTreeImpl> windtree;
+
+        Data();
+        ~Data();
+    };
+
+    std::shared_ptr<const Data> m_data;
+
+    const AABBImpl& aabb() const;
+    const WindTreeImpl& windtree() const;
 public:
 
     EigenMesh3D(const TriangleMesh&);
-    EigenMesh3D(const EigenMesh3D& other);
-    EigenMesh3D& operator=(const EigenMesh3D&);
 
-    ~EigenMesh3D();
+    inline double ground_level() const { return m_data->ground_level; }
 
-    inline double ground_level() const { return m_ground_level; }
-
-    inline const Eigen::MatrixXd& V() const { return m_V; }
-    inline const Eigen::MatrixXi& F() const { return m_F; }
+    inline const Eigen::MatrixXd& V() const { return m_data->V; }
+    inline const Eigen::MatrixXi& F() const { return m_data->F; }
 
     // Result of a raycast
     class hit_result {
@@ -144,7 +157,7 @@ public:
 
         inline Vec3d normal() const {
             if(m_face_id < 0) return {};
-            auto trindex    = m_mesh.m_F.row(m_face_id);
+            auto trindex    = m_mesh.F().row(m_face_id);
             const Vec3d& p1 = m_mesh.V().row(trindex(0));
             const Vec3d& p2 = m_mesh.V().row(trindex(1));
             const Vec3d& p3 = m_mesh.V().row(trindex(2));
@@ -161,6 +174,13 @@ public:
     // Casting a ray on the mesh, returns the distance where the hit occures.
     hit_result query_ray_hit(const Vec3d &s, const Vec3d &dir) const;
 
+    // Casting a batch of rays on the mesh. The results are the same as with
+    // query_ray_hit() for each ray, but the rays are traced through the AABB
+    // tree together which is faster for coherent rays (e.g. a fan of rays
+    // starting from nearby points).
+    std::vector<hit_result> query_ray_hits(const std::vector<Vec3d> &s,
+                                           const std::vector<Vec3d> &dirs) const;
+
     class si_result {
         double m_value;
         int m_fidx;
@@ -182,6 +202,13 @@ public:
     // the index of the triangle and the closest point in mesh coordinate space.
     si_result signed_distance(const Vec3d& p) const;
 
+    // The unsigned squared distances from the points (rows of P) to the mesh,
+    // the indices of the closest triangles and the closest points on them.
+    void squared_distance(const Eigen::MatrixXd& P,
+                          Eigen::VectorXd& sqdists,
+                          Eigen::VectorXi& I,
+                          Eigen::MatrixXd& C) const;
+
     bool inside(const Vec3d& p) const;
 };
 
@@ -205,6 +232,28 @@ public:
     SLASupportsStoppedException();
 };
 
+/// Cache of the support tree computations which depend only on the object
+/// mesh, the support configuration and the individual support points (or
+/// pairs of pillars). If the cache of the previous run is passed to the next
+/// SLASupportTree, only the added or moved support points and the pillars
+/// they are routed into are recomputed, so regenerating the tree after
+/// editing a few support points is fast. The cache has to be cleared if the
+/// mesh changes, a change of the configuration is detected automatically.
+class SupportCache {
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+
+    friend class SLASupportTree;
+public:
+
+    SupportCache();
+    SupportCache(SupportCache&&);
+    SupportCache& operator=(SupportCache&&);
+    ~SupportCache();
+
+    void clear();
+};
+
 /// The class containing mesh data for the generated supports.
 class SLASupportTree {
     class Impl;
@@ -221,15 +270,19 @@ class SLASupportTree {
     bool generate(const PointSet& pts,
                   const EigenMesh3D& mesh,
                   const SupportConfig& cfg = {},
-                  const Controller& ctl = {});
+                  const Controller& ctl = {},
+                  SupportCache *cache = nullptr);
 public:
 
     SLASupportTree();
 
+    /// If a cache is given, the results of the previous run stored in it are
+    /// reused and it will be updated with the results of this run.
     SLASupportTree(const PointSet& pts,
                    const EigenMesh3D& em,
                    const SupportConfig& cfg = {},
-                   const Controller& ctl = {});
+                   const Controller& ctl = {},
+                   SupportCache *cache = nullptr);
 
     SLASupportTree(const SLASupportTree&);
     SLASupportTree& operator=(const SLASupportTree&);
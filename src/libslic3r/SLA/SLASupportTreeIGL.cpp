@@ -13,8 +13,8 @@
 #include "boost/geometry/index/rtree.hpp"
 
 #include <igl/ray_mesh_intersect.h>
+#include <igl/ray_box_intersect.h>
 #include <igl/point_mesh_squared_distance.h>
-#include <igl/remove_duplicate_vertices.h>
 #include <igl/signed_distance.h>
 
 #include "SLASpatIndex.hpp"
@@ -93,64 +93,54 @@ size_t SpatIndex::size() const
  * EigenMesh3D implementation
  * ****************************************************************************/
 
-class EigenMesh3D::AABBImpl: public igl::AABB<Eigen::MatrixXd, 3> {
-public:
-    igl::WindingNumberAABB<Vec3d, Eigen::MatrixXd, Eigen::MatrixXi> windtree;
-};
+class EigenMesh3D::AABBImpl: public igl::AABB<Eigen::MatrixXd, 3> {};
 
-EigenMesh3D::EigenMesh3D(const TriangleMesh& tmesh): m_aabb(new AABBImpl()) {
-    static const double dEPS = 1e-6;
+class EigenMesh3D::WindTreeImpl:
+        public igl::WindingNumberAABB<Vec3d, Eigen::MatrixXd, Eigen::MatrixXi> {};
 
-    const stl_file& stl = tmesh.stl;
+EigenMesh3D::Data::Data(): aabb(new AABBImpl()), windtree(new WindTreeImpl()) {}
 
-    auto&& bb = tmesh.bounding_box();
-    m_ground_level += bb.min(Z);
-
-    Eigen::MatrixXd V;
-    Eigen::MatrixXi F;
-
-    V.resize(3*stl.stats.number_of_facets, 3);
-    F.resize(stl.stats.number_of_facets, 3);
-    for (unsigned int i = 0; i < stl.stats.number_of_facets; ++i) {
-        const stl_facet* facet = stl.facet_start+i;
-        V(3*i+0, 0) = double(facet->vertex[0](0));
-        V(3*i+0, 1) = double(facet->vertex[0](1));
-        V(3*i+0, 2) = double(facet->vertex[0](2));
-
-        V(3*i+1, 0) = double(facet->vertex[1](0));
-        V(3*i+1, 1) = double(facet->vertex[1](1));
-        V(3*i+1, 2) = double(facet->vertex[1](2));
-
-        V(3*i+2, 0) = double(facet->vertex[2](0));
-        V(3*i+2, 1) = double(facet->vertex[2](1));
-        V(3*i+2, 2) = double(facet->vertex[2](2));
-
-        F(i, 0) = int(3*i+0);
-        F(i, 1) = int(3*i+1);
-        F(i, 2) = int(3*i+2);
-    }
+EigenMesh3D::Data::~Data() {}
 
-    // We will convert this to a proper 3d mesh with no duplicate points.
-    Eigen::VectorXi SVI, SVJ;
-    igl::remove_duplicate_vertices(V, F, dEPS, m_V, SVI, SVJ, m_F);
+EigenMesh3D::EigenMesh3D(const TriangleMesh& tmesh) {
+    static const double dEPS = 1e-6;
 
-    // Build the AABB accelaration tree
-    m_aabb->init(m_V, m_F);
-    m_aabb->windtree.set_mesh(m_V, m_F);
-}
+    std::shared_ptr<Data> data = std::make_shared<Data>();
 
-EigenMesh3D::~EigenMesh3D() {}
+    auto&& bb = tmesh.bounding_box();
+    data->ground_level += bb.min(Z);
+
+    // Convert the triangle soup to a proper 3d mesh with no duplicate points.
+    // Unlike igl::remove_duplicate_vertices(), which sorts the vertices and merges those rounding to the same
+    // multiple of dEPS, the vertices are kept in the order of their first use and merged within dEPS distance.
+    std::vector<stl_vertex>       vertices;
+    std::vector<v_indices_struct> indices;
+    tmesh.weld_vertices(float(dEPS), vertices, indices);
+
+    data->V.resize(vertices.size(), 3);
+    for (size_t i = 0; i < vertices.size(); ++i)
+        data->V.row(i) = vertices[i].cast<double>().transpose();
+    data->F.resize(indices.size(), 3);
+    for (size_t i = 0; i < indices.size(); ++i)
+        for (int j = 0; j < 3; ++j)
+            data->F(i, j) = indices[i].vertex[j];
+
+    m_data = std::move(data);
+}
 
-EigenMesh3D::EigenMesh3D(const EigenMesh3D &other):
-    m_V(other.m_V), m_F(other.m_F), m_ground_level(other.m_ground_level),
-    m_aabb( new AABBImpl(*other.m_aabb) ) {}
+const EigenMesh3D::AABBImpl &EigenMesh3D::aabb() const
+{
+    // Build the AABB accelaration tree on the first use
+    const Data& d = *m_data;
+    std::call_once(d.aabb_flag, [&d]() { d.aabb->init(d.V, d.F); });
+    return *d.aabb;
+}
 
-EigenMesh3D &EigenMesh3D::operator=(const EigenMesh3D &other)
+const EigenMesh3D::WindTreeImpl &EigenMesh3D::windtree() const
 {
-    m_V = other.m_V;
-    m_F = other.m_F;
-    m_ground_level = other.m_ground_level;
-    m_aabb.reset(new AABBImpl(*other.m_aabb)); return *this;
+    const Data& d = *m_data;
+    std::call_once(d.windtree_flag, [&d]() { d.windtree->set_mesh(d.V, d.F); });
+    return *d.windtree;
 }
 
 EigenMesh3D::hit_result
@@ -158,7 +148,7 @@ EigenMesh3D::query_ray_hit(const Vec3d &s, const Vec3d &dir) const
 {
     igl::Hit hit;
     hit.t = std::numeric_limits<float>::infinity();
-    m_aabb->intersect_ray(m_V, m_F, s, dir, hit);
+    aabb().intersect_ray(V(), F(), s, dir, hit);
 
     hit_result ret(*this);
     ret.m_t = double(hit.t);
@@ -168,16 +158,114 @@ EigenMesh3D::query_ray_hit(const Vec3d &s, const Vec3d &dir) const
     return ret;
 }
 
+namespace {
+
+using AABBTree = igl::AABB<Eigen::MatrixXd, 3>;
+
+// Traverse the AABB tree depth first with a packet of rays. The rays to be
+// tested against the current node are stored in the range [from, to) of the
+// 'active' stack. Every ray visits the nodes in the same order as with
+// AABB::intersect_ray() and prunes the subtrees behind its own nearest hit,
+// so the results are the same as when casting the rays one by one. The
+// difference is that each node is fetched only once for the whole packet.
+void intersect_ray_packet(const AABBTree& tree,
+                          const Eigen::MatrixXd& V,
+                          const Eigen::MatrixXi& F,
+                          const std::vector<AABBTree::RowVectorDIMS>& origins,
+                          const std::vector<AABBTree::RowVectorDIMS>& dirs,
+                          std::vector<unsigned>& active,
+                          size_t from, size_t to,
+                          std::vector<igl::Hit>& hits)
+{
+    // Select the rays hitting the bounding box of this node before their
+    // nearest hit found so far.
+    size_t begin = active.size();
+    for(size_t i = from; i < to; ++i) {
+        unsigned r = active[i];
+        double tmin, tmax;
+        if(igl::ray_box_intersect(origins[r], dirs[r], tree.m_box,
+                                  0., double(hits[r].t), tmin, tmax))
+            active.emplace_back(r);
+    }
+    size_t end = active.size();
+
+    if(begin == end) return;
+
+    if(tree.is_leaf()) {
+        for(size_t i = begin; i < end; ++i) {
+            unsigned r = active[i];
+            igl::Hit hit;
+            if(igl::ray_mesh_intersect(origins[r], dirs[r], V,
+                                       F.row(tree.m_primitive), hit) &&
+               hit.t < hits[r].t)
+            {
+                hit.id = tree.m_primitive;
+                hits[r] = hit;
+            }
+        }
+    } else {
+        intersect_ray_packet(*tree.m_left, V, F, origins, dirs, active,
+                             begin, end, hits);
+        intersect_ray_packet(*tree.m_right, V, F, origins, dirs, active,
+                             begin, end, hits);
+    }
+
+    active.resize(begin);
+}
+
+}
+
+std::vector<EigenMesh3D::hit_result>
+EigenMesh3D::query_ray_hits(const std::vector<Vec3d> &s,
+                            const std::vector<Vec3d> &dirs) const
+{
+    assert(s.size() == dirs.size());
+
+    std::vector<AABBTree::RowVectorDIMS> origins(s.size()), rdirs(s.size());
+    std::vector<igl::Hit> hits(s.size());
+    std::vector<unsigned> active; active.reserve(4 * s.size());
+
+    for(size_t i = 0; i < s.size(); ++i) {
+        origins[i] = s[i].transpose();
+        rdirs[i] = dirs[i].transpose();
+        hits[i].t = std::numeric_limits<float>::infinity();
+        active.emplace_back(unsigned(i));
+    }
+
+    intersect_ray_packet(aabb(), V(), F(), origins, rdirs, active,
+                         0, active.size(), hits);
+
+    std::vector<hit_result> ret; ret.reserve(s.size());
+    for(size_t i = 0; i < s.size(); ++i) {
+        hit_result hr(*this);
+        hr.m_t = double(hits[i].t);
+        hr.m_dir = dirs[i];
+        if(!std::isinf(hits[i].t) && !std::isnan(hits[i].t))
+            hr.m_face_id = hits[i].id;
+        ret.emplace_back(hr);
+    }
+
+    return ret;
+}
+
 EigenMesh3D::si_result EigenMesh3D::signed_distance(const Vec3d &p) const {
     double sign = 0; double sqdst = 0; int i = 0;  Vec3d c;
-    igl::signed_distance_winding_number(*m_aabb, m_V, m_F, m_aabb->windtree,
+    igl::signed_distance_winding_number(aabb(), V(), F(), windtree(),
                                         p, sign, sqdst, i, c);
 
     return si_result(sign * std::sqrt(sqdst), i, c);
 }
 
+void EigenMesh3D::squared_distance(const Eigen::MatrixXd &P,
+                                   Eigen::VectorXd &sqdists,
+                                   Eigen::VectorXi &I,
+                                   Eigen::MatrixXd &C) const
+{
+    aabb().squared_distance(V(), F(), P, sqdists, I, C);
+}
+
 bool EigenMesh3D::inside(const Vec3d &p) const {
-    return m_aabb->windtree.inside(p);
+    return windtree().inside(p);
 }
 
 /* ****************************************************************************
@@ -209,7 +297,7 @@ PointSet normals(const PointSet& points, const EigenMesh3D& mesh,
     Eigen::VectorXi I;
     PointSet C;
 
-    igl::point_mesh_squared_distance( points, mesh.V(), mesh.F(), dists, I, C);
+    mesh.squared_distance(points, dists, I, C);
 
     PointSet ret(I.rows(), 3);
     for(int i = 0; i < I.rows(); i++) {
@@ -8,7 +8,10 @@
 #include <numeric>
 
 #include <tbb/parallel_for.h>
+#include <tbb/pipeline.h>
+#include <tbb/task_scheduler_init.h>
 #include <boost/log/trivial.hpp>
+#include <boost/filesystem.hpp>
 
 //#include <tbb/spin_mutex.h>//#include "tbb/mutex.h"
 
@@ -25,12 +28,19 @@ using SupportTreePtr = std::unique_ptr<sla::SLASupportTree>;
 class SLAPrintObject::SupportData {
 public:
     sla::EigenMesh3D emesh;              // index-triangle representation
+    Transform3d      trafo;              // the transformation of the emesh
     sla::PointSet    support_points;     // all the support points (manual/auto)
     SupportTreePtr   support_tree_ptr;   // the supports
+    sla::SupportCache support_cache;     // reused when the points are edited
     SlicedSupports   support_slices;     // sliced supports
     std::vector<LevelID>    level_ids;
 
-    inline SupportData(const TriangleMesh& trmesh): emesh(trmesh) {}
+    inline SupportData(const TriangleMesh& trmesh, const Transform3d& tr):
+        emesh(trmesh), trafo(tr) {}
+
+    // Share the (immutable) mesh of the previous support data
+    inline SupportData(const sla::EigenMesh3D& em, const Transform3d& tr):
+        emesh(em), trafo(tr) {}
 };
 
 namespace {
@@ -427,11 +437,6 @@ sla::SupportConfig make_support_cfg(const SLAPrintObjectConfig& c) {
     return scfg;
 }
 
-void swapXY(ExPolygon& expoly) {
-    for(auto& p : expoly.contour.points) std::swap(p(X), p(Y));
-    for(auto& h : expoly.holes) for(auto& p : h.points) std::swap(p(X), p(Y));
-}
-
 }
 
 std::vector<float> SLAPrint::calculate_heights(const BoundingBoxf3& bb3d,
@@ -461,7 +466,6 @@ void report_status(SLAPrint& p, int st, const std::string& msg, Args&&...args) {
 void SLAPrint::process()
 {
     using namespace sla;
-    using ExPolygon = Slic3r::ExPolygon;
 
     // Assumption: at this point the print objects should be populated only with
     // the model objects we have to process and the instances are also filtered
@@ -508,8 +512,21 @@ void SLAPrint::process()
     // support points. Then we sprinkle the rest of the mesh.
     auto support_points = [this, ilh](SLAPrintObject& po) {
         const ModelObject& mo = *po.m_model_object;
-        po.m_supportdata.reset(
-                    new SLAPrintObject::SupportData(po.transformed_mesh()) );
+
+        // If the object mesh and its transformation did not change, keep the
+        // mesh with its AABB tree and the support tree cache of the previous
+        // run (e.g. when only the support points were edited).
+        if(po.m_supportdata && po.m_supportdata->trafo.matrix() ==
+                               po.trafo().matrix()) {
+            auto& prev = *po.m_supportdata;
+            sla::SupportCache cache = std::move(prev.support_cache);
+            po.m_supportdata.reset(
+                        new SLAPrintObject::SupportData(prev.emesh, po.trafo()));
+            po.m_supportdata->support_cache = std::move(cache);
+        } else
+            po.m_supportdata.reset(
+                        new SLAPrintObject::SupportData(po.transformed_mesh(),
+                                                        po.trafo()) );
 
         // If supports are disabled, we can skip the model scan.
         if(!po.m_config.supports_enable.getBool()) return;
@@ -595,7 +612,8 @@ void SLAPrint::process()
 
             po.m_supportdata->support_tree_ptr.reset(
                         new SLASupportTree(po.m_supportdata->support_points,
-                                           po.m_supportdata->emesh, scfg, ctl));
+                                           po.m_supportdata->emesh, scfg, ctl,
+                                           &po.m_supportdata->support_cache));
 
             // Create the unified mesh
             auto rc = SlicingStatus::RELOAD_SCENE;
@@ -811,6 +829,20 @@ void SLAPrint::process()
             m_printer.reset(new SLAPrinter(w, h, pw, ph, lh, exp_t, iexp_t,
                                            flpXY? SLAPrinter::RO_PORTRAIT :
                                                   SLAPrinter::RO_LANDSCAPE));
+
+            // Keep only a handful of the compressed layers in memory, the
+            // finished ones are written out to a temporary file in order.
+            // Without a usable temporary directory all the layers are kept
+            // in memory as before.
+            try {
+                boost::filesystem::path spool_path =
+                        boost::filesystem::temp_directory_path() /
+                        boost::filesystem::unique_path("slic3r-sla-%%%%-%%%%.spool");
+                m_printer->spool(spool_path.string());
+            } catch(std::exception& e) {
+                BOOST_LOG_TRIVIAL(warning)
+                        << "Keeping the SLA layers in memory: " << e.what();
+            }
         }
 
         // Allocate space for all the layers
@@ -827,35 +859,46 @@ void SLAPrint::process()
         double sd = (100 - ist) / 100.0;
         SpinMutex slck;
 
+        // If there are less layers than threads, the layers are split into
+        // horizontal tiles, which are drawn in parallel as well.
+        auto threads = unsigned(
+                    std::max(1, tbb::task_scheduler_init::default_num_threads()));
+        unsigned tiles = lvlcnt < threads ? threads : 1;
+
         // procedure to process one height level. This will run in parallel
         auto lvlfn =
-        [this, &slck, &keys, &printer, slot, sd, ist, &pst, flpXY]
-            (unsigned level_id)
+        [this, &slck, &keys, &printer, slot, sd, ist, &pst, flpXY, tiles]
+            (unsigned level_id) -> unsigned
         {
-            if(canceled()) return;
+            if(canceled()) return level_id;
 
             LayerRefs& lrange = m_printer_input[keys[level_id]];
 
             // Switch to the appropriate layer in the printer
             printer.begin_layer(level_id);
 
-            for(auto& lyrref : lrange) { // for all layers in the current level
-                if(canceled()) break;
-                const Layer& sl = lyrref.lref;   // get the layer reference
-                const LayerCopies& copies = lyrref.copies;
-
-                // Draw all the polygons in the slice to the actual layer.
-                for(auto& cp : copies) {
-                    for(ExPolygon slice : sl) {
-                        // The order is important here:
-                        // apply rotation before translation...
-                        slice.rotate(double(cp.rotation));
-                        slice.translate(cp.shift(X), cp.shift(Y));
-                        if(flpXY) swapXY(slice);
-                        printer.draw_polygon(slice, level_id);
+            auto draw_tile = [this, &lrange, &printer, level_id, tiles, flpXY]
+                    (unsigned tile)
+            {
+                for(auto& lyrref : lrange) { // for all layers in the current level
+                    if(canceled()) break;
+                    const Layer& sl = lyrref.lref;   // get the layer reference
+                    const LayerCopies& copies = lyrref.copies;
+
+                    // Draw all the polygons in the slice to the actual layer.
+                    // The rasterizer transforms the polygons of the instance
+                    // while drawing them, rotation before translation...
+                    for(auto& cp : copies) {
+                        Raster::Trafo tr(double(cp.rotation),
+                                         double(cp.shift(X)),
+                                         double(cp.shift(Y)), flpXY);
+                        printer.draw_polygons(sl, level_id, tr, tile, tiles);
                     }
                 }
-            }
+            };
+
+            if(tiles > 1) tbb::parallel_for(0u, tiles, draw_tile);
+            else draw_tile(0);
 
             // Finish the layer for later saving it.
             printer.finish_layer(level_id);
@@ -868,6 +911,8 @@ void SLAPrint::process()
                 pst = st;
             }
             }
+
+            return level_id;
         };
 
         // last minute escape
@@ -876,8 +921,25 @@ void SLAPrint::process()
         // Sequential version (for testing)
         // for(unsigned l = 0; l < lvlcnt; ++l) process_level(l);
 
-        // Print all the layers in parallel
-        tbb::parallel_for<unsigned, decltype(lvlfn)>(0, lvlcnt, lvlfn);
+        // Print all the layers in parallel and spool them in order. A layer
+        // holds its pipeline token until it is spooled, so a layer finished
+        // behind a slow one waits in memory, but no new layer is started
+        // then: at most 2 * threads rasters or compressed layers exist.
+        unsigned next_level = 0;
+        tbb::parallel_pipeline(2 * threads,
+            tbb::make_filter<void, unsigned>(tbb::filter::serial_in_order,
+                [&next_level, lvlcnt](tbb::flow_control& fc) -> unsigned {
+                    if(next_level == lvlcnt) { fc.stop(); return 0; }
+                    return next_level++;
+                }) &
+            tbb::make_filter<unsigned, unsigned>(tbb::filter::parallel, lvlfn) &
+            tbb::make_filter<unsigned, void>(tbb::filter::serial_in_order,
+                [&printer](unsigned level_id) {
+                    printer.spool_layer(level_id);
+                }));
+
+        // The rasters are only reused while rasterizing, free them now.
+        printer.release_rasters();
     };
 
     using slaposFn = std::function<void(SLAPrintObject&)>;
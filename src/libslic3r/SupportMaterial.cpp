@@ -14,8 +14,10 @@
 
 #include <tbb/parallel_for.h>
 #include <tbb/atomic.h>
-#include <tbb/spin_mutex.h>
 #include <tbb/task_group.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/pipeline.h>
+#include <tbb/task_scheduler_init.h>
 
 // #define SLIC3R_DEBUG
 
@@ -184,27 +186,38 @@ PrintObjectSupportMaterial::PrintObjectSupportMaterial(const PrintObject *object
     }
 }
 
-// Using the std::deque as an allocator.
-inline PrintObjectSupportMaterial::MyLayer& layer_allocate(
-    std::deque<PrintObjectSupportMaterial::MyLayer> &layer_storage, 
-    PrintObjectSupportMaterial::SupporLayerType      layer_type)
-{ 
-    layer_storage.push_back(PrintObjectSupportMaterial::MyLayer());
-    layer_storage.back().layer_type = layer_type;
-    return layer_storage.back();
-}
+// Support layers are allocated by chunks from pools local to the allocating threads, therefore the layers may be allocated
+// from parallel loops without locking. All the layers are released at once when the storage is destroyed at the end of generate().
+class PrintObjectSupportMaterial::MyLayerStorage
+{
+public:
+    MyLayer& allocate(SupporLayerType layer_type)
+    {
+        Pool &pool = m_pools.local();
+        if (pool.used == CHUNK_SIZE) {
+            pool.chunks.emplace_back(new MyLayer[CHUNK_SIZE]);
+            pool.used = 0;
+        }
+        MyLayer &layer = pool.chunks.back()[pool.used ++];
+        layer.layer_type = layer_type;
+        return layer;
+    }
+
+private:
+    enum { CHUNK_SIZE = 64 };
+    struct Pool {
+        std::vector<std::unique_ptr<MyLayer[]>> chunks;
+        // Number of layers allocated from the last chunk.
+        size_t                                  used = CHUNK_SIZE;
+    };
+    tbb::enumerable_thread_specific<Pool>       m_pools;
+};
 
 inline PrintObjectSupportMaterial::MyLayer& layer_allocate(
-    std::deque<PrintObjectSupportMaterial::MyLayer> &layer_storage,
-    tbb::spin_mutex                                 &layer_storage_mutex,
-    PrintObjectSupportMaterial::SupporLayerType      layer_type)
+    PrintObjectSupportMaterial::MyLayerStorage  &layer_storage, 
+    PrintObjectSupportMaterial::SupporLayerType  layer_type)
 { 
-    layer_storage_mutex.lock();
-    layer_storage.push_back(PrintObjectSupportMaterial::MyLayer());
-    PrintObjectSupportMaterial::MyLayer *layer_new = &layer_storage.back();
-    layer_storage_mutex.unlock();
-    layer_new->layer_type = layer_type;
-    return *layer_new;
+    return layer_storage.allocate(layer_type);
 }
 
 inline void layers_append(PrintObjectSupportMaterial::MyLayersPtr &dst, const PrintObjectSupportMaterial::MyLayersPtr &src)
@@ -1013,9 +1026,8 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::top_contact_
     // For each overhang layer, two supporting layers may be generated: One for the overhangs extruded with a bridging flow, 
     // and the other for the overhangs extruded with a normal flow.
     contact_out.assign(num_layers * 2, nullptr);
-    tbb::spin_mutex layer_storage_mutex;
     tbb::parallel_for(tbb::blocked_range<size_t>(this->has_raft() ? 0 : 1, num_layers),
-        [this, &object, &buildplate_covered, &enforcers, &blockers, support_auto, threshold_rad, &layer_storage, &layer_storage_mutex, &contact_out]
+        [this, &object, &buildplate_covered, &enforcers, &blockers, support_auto, threshold_rad, &layer_storage, &contact_out]
         (const tbb::blocked_range<size_t>& range) {
             for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) 
             {
@@ -1191,7 +1203,7 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::top_contact_
                 
                 // Now apply the contact areas to the layer where they need to be made.
                 if (! contact_polygons.empty()) {
-                    MyLayer     &new_layer = layer_allocate(layer_storage, layer_storage_mutex, sltTopContact);
+                    MyLayer     &new_layer = layer_allocate(layer_storage, sltTopContact);
                     new_layer.idx_object_layer_above = layer_id;
                     MyLayer     *bridging_layer = nullptr;
                     if (layer_id == 0) {
@@ -1243,7 +1255,7 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::top_contact_
                                 }
                                 if (bridging_print_z < new_layer.print_z - EPSILON) {
                                     // Allocate the new layer.
-                                    bridging_layer = &layer_allocate(layer_storage, layer_storage_mutex, sltTopContact);
+                                    bridging_layer = &layer_allocate(layer_storage, sltTopContact);
                                     bridging_layer->idx_object_layer_above = layer_id;
                                     bridging_layer->print_z = bridging_print_z;
                                     if (bridging_print_z == m_slicing_params.first_print_layer_height) {
@@ -1430,42 +1442,174 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::bottom_conta
     if (! top_contacts.empty()) 
     {
         // There is some support to be built, if there are non-empty top surfaces detected.
+        // The projection of the contact areas is propagated from the top layer downwards, where the projection of layer N
+        // is clipped by the object and snapped to the support grid before it is handed over to layer N-1. This recurrence is inherently
+        // sequential, therefore it is run as a serial stage of a pipeline, while the work not depending on the projection
+        // of the layers above (the trimming polygons, the top surfaces, the unions of the contact areas) is calculated ahead
+        // for a band of layers in parallel, and the work depending only on the projection of this layer (the support area
+        // extraction and the detection of the bottom contacts) is calculated for a band of layers in parallel afterwards.
+        // Only the allocation of the bottom contact layers and the trimming of the support areas above them are serialized again,
+        // so that the result is identical to the result of the sequential algorithm.
+        struct LayerToProcess {
+            int                                 layer_id;
+            // Last top contact layer visited when collecting the projection of contact areas.
+            int                                 contact_idx;
+            // Contact areas above or at the same level as this layer, not yet collected by the layers above.
+            int                                 contact_idx_above;
+            // Unions of the newly collected contact areas, one union per contact layer.
+            Polygons                            contacts;
+            // Top surfaces of this layer, used to detect the bottom contacts.
+            Polygons                            top;
+            // Object slices with a slight positive offset, used to trim the projection.
+            Polygons                            trimming;
+            // Sum of unsupported contact areas above the current layer.print_z.
+            Polygons                            projection_raw;
+            // projection_raw trimmed by the object, referenced by support_grid_pattern.
+            Polygons                            projection;
+            std::unique_ptr<SupportGridPattern> support_grid_pattern;
+            // Contact areas supported exclusively by the top surfaces of this layer.
+            bool                                has_bottom_contact = false;
+            Polygons                            touching;
+            Polygons                            bottom_contact_polygons;
+        };
+        typedef std::shared_ptr<LayerToProcess> LayerToProcessPtr;
+
+        const bool buildplate_only = m_object_config->support_material_buildplate_only.value;
         // Sum of unsupported contact areas above the current layer.print_z.
         Polygons  projection;
         // Last top contact layer visited when collecting the projection of contact areas.
         int       contact_idx = int(top_contacts.size()) - 1;
-        for (int layer_id = int(object.total_layer_count()) - 2; layer_id >= 0; -- layer_id) {
-            BOOST_LOG_TRIVIAL(trace) << "Support generator - bottom_contact_layers - layer " << layer_id;
-            const Layer &layer = *object.get_layer(layer_id);
-            // Collect projections of all contact areas above or at the same level as this top surface.
-            for (; contact_idx >= 0 && top_contacts[contact_idx]->print_z > layer.print_z - EPSILON; -- contact_idx) {
-                Polygons polygons_new;
-                // Contact surfaces are expanded away from the object, trimmed by the object.
-                // Use a slight positive offset to overlap the touching regions.
+        int       next_layer_id = int(object.total_layer_count()) - 2;
+        // Layers in flight, limits the memory held by the support grid patterns.
+        const size_t max_tokens = 4 * size_t(std::max(1, tbb::task_scheduler_init::default_num_threads()));
+        tbb::parallel_pipeline(max_tokens,
+            tbb::make_filter<void, LayerToProcessPtr>(tbb::filter::serial_in_order,
+                [&object, &top_contacts, &contact_idx, &next_layer_id](tbb::flow_control &fc) -> LayerToProcessPtr {
+                    if (next_layer_id < 0) {
+                        fc.stop();
+                        return LayerToProcessPtr();
+                    }
+                    LayerToProcessPtr layer_to_process = std::make_shared<LayerToProcess>();
+                    layer_to_process->layer_id          = next_layer_id --;
+                    layer_to_process->contact_idx_above = contact_idx;
+                    const Layer &layer = *object.get_layer(layer_to_process->layer_id);
+                    // Collect projections of all contact areas above or at the same level as this top surface.
+                    for (; contact_idx >= 0 && top_contacts[contact_idx]->print_z > layer.print_z - EPSILON; -- contact_idx) ;
+                    layer_to_process->contact_idx = contact_idx;
+                    return layer_to_process;
+                }) &
+            // Calculate the data not depending on the projection of the layers above.
+            tbb::make_filter<LayerToProcessPtr, LayerToProcessPtr>(tbb::filter::parallel,
+                [&object, &top_contacts, buildplate_only](LayerToProcessPtr layer_to_process) -> LayerToProcessPtr {
+                    if (layer_to_process->contact_idx_above == int(top_contacts.size()) - 1 && 
+                        layer_to_process->contact_idx == layer_to_process->contact_idx_above)
+                        // No contact area collected yet, the projection is empty.
+                        return layer_to_process;
+                    const Layer &layer = *object.get_layer(layer_to_process->layer_id);
+                    for (int idx = layer_to_process->contact_idx_above; idx > layer_to_process->contact_idx; -- idx) {
+                        Polygons polygons_new;
+                        // Contact surfaces are expanded away from the object, trimmed by the object.
+                        // Use a slight positive offset to overlap the touching regions.
 #if 0
-                // Merge and collect the contact polygons. The contact polygons are inflated, but not extended into a grid form.
-                polygons_append(polygons_new, offset(*top_contacts[contact_idx]->contact_polygons, SCALED_EPSILON));
+                        // Merge and collect the contact polygons. The contact polygons are inflated, but not extended into a grid form.
+                        polygons_append(polygons_new, offset(*top_contacts[idx]->contact_polygons, SCALED_EPSILON));
 #else
-                // Consume the contact_polygons. The contact polygons are already expanded into a grid form, and they are a tiny bit smaller
-                // than the grid cells.
-                polygons_append(polygons_new, std::move(*top_contacts[contact_idx]->contact_polygons));
+                        // Consume the contact_polygons. The contact polygons are already expanded into a grid form, and they are a tiny bit smaller
+                        // than the grid cells.
+                        polygons_append(polygons_new, std::move(*top_contacts[idx]->contact_polygons));
 #endif
-                // These are the overhang surfaces. They are touching the object and they are not expanded away from the object.
-                // Use a slight positive offset to overlap the touching regions.
-                polygons_append(polygons_new, offset(*top_contacts[contact_idx]->overhang_polygons, float(SCALED_EPSILON)));
-                polygons_append(projection, union_(polygons_new));
-            }
-            if (projection.empty())
-                continue;
-            Polygons projection_raw = union_(projection);
-
-            tbb::task_group task_group;
-            if (! m_object_config->support_material_buildplate_only)
-                // Find the bottom contact layers above the top surfaces of this layer.
-                task_group.run([this, &object, &top_contacts, contact_idx, &layer, layer_id, &layer_storage, &layer_support_areas, &bottom_contacts, &projection_raw] {
-                    Polygons top = collect_region_slices_by_type(layer, stTop);
-        #ifdef SLIC3R_DEBUG
+                        // These are the overhang surfaces. They are touching the object and they are not expanded away from the object.
+                        // Use a slight positive offset to overlap the touching regions.
+                        polygons_append(polygons_new, offset(*top_contacts[idx]->overhang_polygons, float(SCALED_EPSILON)));
+                        polygons_append(layer_to_process->contacts, union_(polygons_new));
+                    }
+                    if (! buildplate_only)
+                        layer_to_process->top = collect_region_slices_by_type(layer, stTop);
+                    // Remove the areas that touched from the projection that will continue on next, lower, top surfaces.
+        //            Polygons trimming = union_(to_polygons(layer.slices.expolygons), touching, true);
+                    layer_to_process->trimming = offset(layer.slices.expolygons, float(SCALED_EPSILON));
+                    return layer_to_process;
+                }) &
+            // Propagate the projection down by a single layer.
+            tbb::make_filter<LayerToProcessPtr, LayerToProcessPtr>(tbb::filter::serial_in_order,
+                [this, &projection
+        #ifdef SLIC3R_DEBUG 
+                    , &object
+        #endif /* SLIC3R_DEBUG */
+                    ](LayerToProcessPtr layer_to_process) -> LayerToProcessPtr {
+                    BOOST_LOG_TRIVIAL(trace) << "Support generator - bottom_contact_layers - layer " << layer_to_process->layer_id;
+                    polygons_append(projection, std::move(layer_to_process->contacts));
+                    if (projection.empty())
+                        return layer_to_process;
+                    layer_to_process->projection_raw = union_(projection);
+                    const Polygons &projection_raw   = layer_to_process->projection_raw;
+                    const Polygons &trimming         = layer_to_process->trimming;
+                    Polygons       &projection_this  = layer_to_process->projection;
+                    projection_this = diff(projection_raw, trimming, false);
+    #ifdef SLIC3R_DEBUG
                     {
+                        const Layer &layer = *object.get_layer(layer_to_process->layer_id);
+                        BoundingBox bbox = get_extents(projection_raw);
+                        bbox.merge(get_extents(trimming));
+                        ::Slic3r::SVG svg(debug_out_path("support-support-areas-raw-%d-%lf.svg", iRun, layer.print_z), bbox);
+                        svg.draw(union_ex(trimming, false), "blue", 0.5f);
+                        svg.draw(union_ex(projection_this, true), "red", 0.5f);
+                        svg.draw_outline(union_ex(projection_this, true), "red", "blue", scale_(0.1f));
+                    }
+    #endif /* SLIC3R_DEBUG */
+                    remove_sticks(projection_this);
+                    remove_degenerate(projection_this);
+        #ifdef SLIC3R_DEBUG
+                    Slic3r::SVG::export_expolygons(
+                        debug_out_path("support-support-areas-raw-cleaned-%d-%lf.svg", iRun, object.get_layer(layer_to_process->layer_id)->print_z),
+                        union_ex(projection_this, false));
+        #endif /* SLIC3R_DEBUG */
+                    layer_to_process->support_grid_pattern.reset(new SupportGridPattern(
+                        // Support islands, to be stretched into a grid.
+                        projection_this, 
+                        // Trimming polygons, to trim the stretched support islands.
+                        trimming,
+                        // Grid spacing.
+                        m_object_config->support_material_spacing.value + m_support_material_flow.spacing(),
+                        Geometry::deg2rad(m_object_config->support_material_angle.value)));
+                    // Support polygons will be projected down. To keep the interface and base layers from growing, return a contour a tiny bit smaller than the grid cells.
+                    projection = layer_to_process->support_grid_pattern->extract_support(-5, true);
+        #ifdef SLIC3R_DEBUG
+                    Slic3r::SVG::export_expolygons(
+                        debug_out_path("support-projection_new-gridded-%d-%lf.svg", iRun, object.get_layer(layer_to_process->layer_id)->print_z),
+                        union_ex(projection, false));
+        #endif /* SLIC3R_DEBUG */
+                    return layer_to_process;
+                }) &
+            // Calculate the data depending on the projection of this layer only.
+            tbb::make_filter<LayerToProcessPtr, LayerToProcessPtr>(tbb::filter::parallel,
+                [this, &layer_support_areas
+        #ifdef SLIC3R_DEBUG 
+                    , &object
+        #endif /* SLIC3R_DEBUG */
+                    ](LayerToProcessPtr layer_to_process) -> LayerToProcessPtr {
+                    if (! layer_to_process->support_grid_pattern)
+                        return layer_to_process;
+        #ifdef SLIC3R_DEBUG
+                    const Layer &layer = *object.get_layer(layer_to_process->layer_id);
+        #endif /* SLIC3R_DEBUG */
+                    // Cache the slice of a support volume. The support volume is expanded by 1/2 of support material flow spacing
+                    // to allow a placement of suppot zig-zag snake along the grid lines.
+                    Polygons &layer_support_area = layer_support_areas[layer_to_process->layer_id];
+                    layer_support_area = layer_to_process->support_grid_pattern->extract_support(m_support_material_flow.scaled_spacing()/2 + 25, true);
+        #ifdef SLIC3R_DEBUG
+                    Slic3r::SVG::export_expolygons(
+                        debug_out_path("support-layer_support_area-gridded-%d-%lf.svg", iRun, layer.print_z),
+                        union_ex(layer_support_area, false));
+        #endif /* SLIC3R_DEBUG */
+                    // Release the grid early.
+                    layer_to_process->support_grid_pattern.reset();
+                    layer_to_process->projection.clear();
+                    layer_to_process->trimming.clear();
+                    const Polygons &top            = layer_to_process->top;
+                    const Polygons &projection_raw = layer_to_process->projection_raw;
+        #ifdef SLIC3R_DEBUG
+                    if (! m_object_config->support_material_buildplate_only) {
                         BoundingBox bbox = get_extents(projection_raw);
                         bbox.merge(get_extents(top));
                         ::Slic3r::SVG svg(debug_out_path("support-bottom-layers-raw-%d-%lf.svg", iRun, layer.print_z), bbox);
@@ -1475,165 +1619,116 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::bottom_conta
                         svg.draw(layer.slices.expolygons, "green", 0.5f);
                     }
         #endif /* SLIC3R_DEBUG */
-
                     // Now find whether any projection of the contact surfaces above layer.print_z not yet supported by any 
                     // top surfaces above layer.print_z falls onto this top surface. 
                     // Touching are the contact surfaces supported exclusively by this top surfaces.
                     // Don't use a safety offset as it has been applied during insertion of polygons.
+                    // top is empty for support_material_buildplate_only.
                     if (! top.empty()) {
                         Polygons touching = intersection(top, projection_raw, false);
                         if (! touching.empty()) {
-                            // Allocate a new bottom contact layer.
-                            MyLayer &layer_new = layer_allocate(layer_storage, sltBottomContact);
-                            bottom_contacts.push_back(&layer_new);
                             // Grow top surfaces so that interface and support generation are generated
                             // with some spacing from object - it looks we don't need the actual
                             // top shapes so this can be done here
-                            //FIXME calculate layer height based on the actual thickness of the layer:
-                            // If the layer is extruded with no bridging flow, support just the normal extrusions.
-                            layer_new.height  = m_slicing_params.soluble_interface ? 
-                                // Align the interface layer with the object's layer height.
-                                object.layers()[layer_id + 1]->height :
-                                // Place a bridge flow interface layer over the top surface.
-                                //FIXME Check whether the bottom bridging surfaces are extruded correctly (no bridging flow correction applied?)
-                                // According to Jindrich the bottom surfaces work well.
-                                //FIXME test the bridging flow instead?
-                                m_support_material_interface_flow.nozzle_diameter;
-                            layer_new.print_z = m_slicing_params.soluble_interface ? object.layers()[layer_id + 1]->print_z :
-                                layer.print_z + layer_new.height + m_object_config->support_material_contact_distance.value;
-                            layer_new.bottom_z = layer.print_z;
-                            layer_new.idx_object_layer_below = layer_id;
-                            layer_new.bridging = ! m_slicing_params.soluble_interface;
                             //FIXME how much to inflate the bottom surface, as it is being extruded with a bridging flow? The following line uses a normal flow.
                             //FIXME why is the offset positive? It will be trimmed by the object later on anyway, but then it just wastes CPU clocks.
-                            layer_new.polygons = offset(touching, float(m_support_material_flow.scaled_width()), SUPPORT_SURFACES_OFFSET_PARAMETERS);
-                            if (! m_slicing_params.soluble_interface) {
-                                // Walk the top surfaces, snap the top of the new bottom surface to the closest top of the top surface,
-                                // so there will be no support surfaces generated with thickness lower than m_support_layer_height_min.
-                                for (size_t top_idx = size_t(std::max<int>(0, contact_idx)); 
-                                    top_idx < top_contacts.size() && top_contacts[top_idx]->print_z < layer_new.print_z + this->m_support_layer_height_min + EPSILON; 
-                                    ++ top_idx) {
-                                    if (top_contacts[top_idx]->print_z > layer_new.print_z - this->m_support_layer_height_min - EPSILON) {
-                                        // A top layer has been found, which is close to the new bottom layer.
-                                        coordf_t diff = layer_new.print_z - top_contacts[top_idx]->print_z;
-                                        assert(std::abs(diff) <= this->m_support_layer_height_min + EPSILON);
-                                        if (diff > 0.) {
-                                            // The top contact layer is below this layer. Make the bridging layer thinner to align with the existing top layer.
-                                            assert(diff < layer_new.height + EPSILON);
-                                            assert(layer_new.height - diff >= m_support_layer_height_min - EPSILON);
-                                            layer_new.print_z  = top_contacts[top_idx]->print_z;
-                                            layer_new.height  -= diff;
-                                        } else {
-                                            // The top contact layer is above this layer. One may either make this layer thicker or thinner.
-                                            // By making the layer thicker, one will decrease the number of discrete layers with the price of extruding a bit too thick bridges.
-                                            // By making the layer thinner, one adds one more discrete layer.
-                                            layer_new.print_z  = top_contacts[top_idx]->print_z;
-                                            layer_new.height  -= diff;
-                                        }
-                                        break;
-                                    }
+                            layer_to_process->bottom_contact_polygons = offset(touching, float(m_support_material_flow.scaled_width()), SUPPORT_SURFACES_OFFSET_PARAMETERS);
+                            layer_to_process->touching = offset(touching, float(SCALED_EPSILON));
+                            layer_to_process->has_bottom_contact = true;
+                        }
+                    }
+                    layer_to_process->projection_raw.clear();
+                    layer_to_process->top.clear();
+                    return layer_to_process;
+                }) &
+            // Find the bottom contact layers above the top surfaces of this layer.
+            tbb::make_filter<LayerToProcessPtr, void>(tbb::filter::serial_in_order,
+                [this, &object, &top_contacts, &layer_storage, &layer_support_areas, &bottom_contacts](LayerToProcessPtr layer_to_process) {
+                    if (! layer_to_process->has_bottom_contact)
+                        return;
+                    const int    layer_id    = layer_to_process->layer_id;
+                    const int    contact_idx = layer_to_process->contact_idx;
+                    const Layer &layer       = *object.get_layer(layer_id);
+                    // Allocate a new bottom contact layer.
+                    MyLayer &layer_new = layer_allocate(layer_storage, sltBottomContact);
+                    bottom_contacts.push_back(&layer_new);
+                    //FIXME calculate layer height based on the actual thickness of the layer:
+                    // If the layer is extruded with no bridging flow, support just the normal extrusions.
+                    layer_new.height  = m_slicing_params.soluble_interface ? 
+                        // Align the interface layer with the object's layer height.
+                        object.layers()[layer_id + 1]->height :
+                        // Place a bridge flow interface layer over the top surface.
+                        //FIXME Check whether the bottom bridging surfaces are extruded correctly (no bridging flow correction applied?)
+                        // According to Jindrich the bottom surfaces work well.
+                        //FIXME test the bridging flow instead?
+                        m_support_material_interface_flow.nozzle_diameter;
+                    layer_new.print_z = m_slicing_params.soluble_interface ? object.layers()[layer_id + 1]->print_z :
+                        layer.print_z + layer_new.height + m_object_config->support_material_contact_distance.value;
+                    layer_new.bottom_z = layer.print_z;
+                    layer_new.idx_object_layer_below = layer_id;
+                    layer_new.bridging = ! m_slicing_params.soluble_interface;
+                    layer_new.polygons = std::move(layer_to_process->bottom_contact_polygons);
+                    if (! m_slicing_params.soluble_interface) {
+                        // Walk the top surfaces, snap the top of the new bottom surface to the closest top of the top surface,
+                        // so there will be no support surfaces generated with thickness lower than m_support_layer_height_min.
+                        for (size_t top_idx = size_t(std::max<int>(0, contact_idx)); 
+                            top_idx < top_contacts.size() && top_contacts[top_idx]->print_z < layer_new.print_z + this->m_support_layer_height_min + EPSILON; 
+                            ++ top_idx) {
+                            if (top_contacts[top_idx]->print_z > layer_new.print_z - this->m_support_layer_height_min - EPSILON) {
+                                // A top layer has been found, which is close to the new bottom layer.
+                                coordf_t diff = layer_new.print_z - top_contacts[top_idx]->print_z;
+                                assert(std::abs(diff) <= this->m_support_layer_height_min + EPSILON);
+                                if (diff > 0.) {
+                                    // The top contact layer is below this layer. Make the bridging layer thinner to align with the existing top layer.
+                                    assert(diff < layer_new.height + EPSILON);
+                                    assert(layer_new.height - diff >= m_support_layer_height_min - EPSILON);
+                                    layer_new.print_z  = top_contacts[top_idx]->print_z;
+                                    layer_new.height  -= diff;
+                                } else {
+                                    // The top contact layer is above this layer. One may either make this layer thicker or thinner.
+                                    // By making the layer thicker, one will decrease the number of discrete layers with the price of extruding a bit too thick bridges.
+                                    // By making the layer thinner, one adds one more discrete layer.
+                                    layer_new.print_z  = top_contacts[top_idx]->print_z;
+                                    layer_new.height  -= diff;
                                 }
+                                break;
                             }
-                #ifdef SLIC3R_DEBUG
-                            Slic3r::SVG::export_expolygons(
-                                debug_out_path("support-bottom-contacts-%d-%lf.svg", iRun, layer_new.print_z),
-                                union_ex(layer_new.polygons, false));
-                #endif /* SLIC3R_DEBUG */
-                            // Trim the already created base layers above the current layer intersecting with the new bottom contacts layer.
-                            //FIXME Maybe this is no more needed, as the overlapping base layers are trimmed by the bottom layers at the final stage?
-                            touching = offset(touching, float(SCALED_EPSILON));
-                            for (int layer_id_above = layer_id + 1; layer_id_above < int(object.total_layer_count()); ++ layer_id_above) {
-                                const Layer &layer_above = *object.layers()[layer_id_above];
-                                if (layer_above.print_z > layer_new.print_z - EPSILON)
-                                    break; 
-                                if (! layer_support_areas[layer_id_above].empty()) {
+                        }
+                    }
+        #ifdef SLIC3R_DEBUG
+                    Slic3r::SVG::export_expolygons(
+                        debug_out_path("support-bottom-contacts-%d-%lf.svg", iRun, layer_new.print_z),
+                        union_ex(layer_new.polygons, false));
+        #endif /* SLIC3R_DEBUG */
+                    // Trim the already created base layers above the current layer intersecting with the new bottom contacts layer.
+                    // The support areas of the layers above have already been extracted by the previous stage, as the layers
+                    // pass this stage in order.
+                    //FIXME Maybe this is no more needed, as the overlapping base layers are trimmed by the bottom layers at the final stage?
+                    const Polygons &touching = layer_to_process->touching;
+                    for (int layer_id_above = layer_id + 1; layer_id_above < int(object.total_layer_count()); ++ layer_id_above) {
+                        const Layer &layer_above = *object.layers()[layer_id_above];
+                        if (layer_above.print_z > layer_new.print_z - EPSILON)
+                            break; 
+                        if (! layer_support_areas[layer_id_above].empty()) {
 #ifdef SLIC3R_DEBUG
-                                    {
-                                        BoundingBox bbox = get_extents(touching);
-                                        bbox.merge(get_extents(layer_support_areas[layer_id_above]));
-                                        ::Slic3r::SVG svg(debug_out_path("support-support-areas-raw-before-trimming-%d-with-%f-%lf.svg", iRun, layer.print_z, layer_above.print_z), bbox);
-                                        svg.draw(union_ex(touching, false), "blue", 0.5f);
-                                        svg.draw(union_ex(layer_support_areas[layer_id_above], true), "red", 0.5f);
-                                        svg.draw_outline(union_ex(layer_support_areas[layer_id_above], true), "red", "blue", scale_(0.1f));
-                                    }
+                            {
+                                BoundingBox bbox = get_extents(touching);
+                                bbox.merge(get_extents(layer_support_areas[layer_id_above]));
+                                ::Slic3r::SVG svg(debug_out_path("support-support-areas-raw-before-trimming-%d-with-%f-%lf.svg", iRun, layer.print_z, layer_above.print_z), bbox);
+                                svg.draw(union_ex(touching, false), "blue", 0.5f);
+                                svg.draw(union_ex(layer_support_areas[layer_id_above], true), "red", 0.5f);
+                                svg.draw_outline(union_ex(layer_support_areas[layer_id_above], true), "red", "blue", scale_(0.1f));
+                            }
 #endif /* SLIC3R_DEBUG */
-                                    layer_support_areas[layer_id_above] = diff(layer_support_areas[layer_id_above], touching);
+                            layer_support_areas[layer_id_above] = diff(layer_support_areas[layer_id_above], touching);
 #ifdef SLIC3R_DEBUG
-                                    Slic3r::SVG::export_expolygons(
-                                        debug_out_path("support-support-areas-raw-after-trimming-%d-with-%f-%lf.svg", iRun, layer.print_z, layer_above.print_z),
-                                        union_ex(layer_support_areas[layer_id_above], false));
+                            Slic3r::SVG::export_expolygons(
+                                debug_out_path("support-support-areas-raw-after-trimming-%d-with-%f-%lf.svg", iRun, layer.print_z, layer_above.print_z),
+                                union_ex(layer_support_areas[layer_id_above], false));
 #endif /* SLIC3R_DEBUG */
-                                }
-                            }
                         }
-                    } // ! top.empty()
-                });
-
-            Polygons &layer_support_area = layer_support_areas[layer_id];
-            task_group.run([this, &projection, &projection_raw, &layer, &layer_support_area, layer_id] {
-                // Remove the areas that touched from the projection that will continue on next, lower, top surfaces.
-    //            Polygons trimming = union_(to_polygons(layer.slices.expolygons), touching, true);
-                Polygons trimming = offset(layer.slices.expolygons, float(SCALED_EPSILON));
-                projection = diff(projection_raw, trimming, false);
-    #ifdef SLIC3R_DEBUG
-                {
-                    BoundingBox bbox = get_extents(projection_raw);
-                    bbox.merge(get_extents(trimming));
-                    ::Slic3r::SVG svg(debug_out_path("support-support-areas-raw-%d-%lf.svg", iRun, layer.print_z), bbox);
-                    svg.draw(union_ex(trimming, false), "blue", 0.5f);
-                    svg.draw(union_ex(projection, true), "red", 0.5f);
-                    svg.draw_outline(union_ex(projection, true), "red", "blue", scale_(0.1f));
-                }
-    #endif /* SLIC3R_DEBUG */
-                remove_sticks(projection);
-                remove_degenerate(projection);
-        #ifdef SLIC3R_DEBUG
-                Slic3r::SVG::export_expolygons(
-                    debug_out_path("support-support-areas-raw-cleaned-%d-%lf.svg", iRun, layer.print_z),
-                    union_ex(projection, false));
-        #endif /* SLIC3R_DEBUG */
-                SupportGridPattern support_grid_pattern(
-                    // Support islands, to be stretched into a grid.
-                    projection, 
-                    // Trimming polygons, to trim the stretched support islands.
-                    trimming,
-                    // Grid spacing.
-                    m_object_config->support_material_spacing.value + m_support_material_flow.spacing(),
-                    Geometry::deg2rad(m_object_config->support_material_angle.value));
-                tbb::task_group task_group_inner;
-                // 1) Cache the slice of a support volume. The support volume is expanded by 1/2 of support material flow spacing
-                // to allow a placement of suppot zig-zag snake along the grid lines.
-                task_group_inner.run([this, &support_grid_pattern, &layer_support_area
-        #ifdef SLIC3R_DEBUG 
-                    , &layer
-        #endif /* SLIC3R_DEBUG */
-                    ] {
-                    layer_support_area = support_grid_pattern.extract_support(m_support_material_flow.scaled_spacing()/2 + 25, true);
-        #ifdef SLIC3R_DEBUG
-                    Slic3r::SVG::export_expolygons(
-                        debug_out_path("support-layer_support_area-gridded-%d-%lf.svg", iRun, layer.print_z),
-                        union_ex(layer_support_area, false));
-        #endif /* SLIC3R_DEBUG */
-                });
-                // 2) Support polygons will be projected down. To keep the interface and base layers from growing, return a contour a tiny bit smaller than the grid cells.
-                Polygons projection_new;
-                task_group_inner.run([&projection_new, &support_grid_pattern
-        #ifdef SLIC3R_DEBUG 
-                    , &layer
-        #endif /* SLIC3R_DEBUG */
-                    ] {
-                    projection_new = support_grid_pattern.extract_support(-5, true);
-        #ifdef SLIC3R_DEBUG
-                    Slic3r::SVG::export_expolygons(
-                        debug_out_path("support-projection_new-gridded-%d-%lf.svg", iRun, layer.print_z),
-                        union_ex(projection_new, false));
-        #endif /* SLIC3R_DEBUG */
-                });
-                task_group_inner.wait();
-                projection = std::move(projection_new);
-            });
-            task_group.wait();
-        }
+                    }
+                }));
         std::reverse(bottom_contacts.begin(), bottom_contacts.end());
 //        trim_support_layers_by_object(object, bottom_contacts, 0., 0., m_gap_xy);
         trim_support_layers_by_object(object, bottom_contacts, 
@@ -2241,9 +2336,8 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::generate_int
         // For all intermediate layers, collect top contact surfaces, which are not further than support_material_interface_layers.
         BOOST_LOG_TRIVIAL(debug) << "PrintObjectSupportMaterial::generate_interface_layers() in parallel - start";
         interface_layers.assign(intermediate_layers.size(), nullptr);
-        tbb::spin_mutex layer_storage_mutex;
         tbb::parallel_for(tbb::blocked_range<size_t>(0, intermediate_layers.size()),
-            [this, &bottom_contacts, &top_contacts, &intermediate_layers, &layer_storage, &layer_storage_mutex, &interface_layers](const tbb::blocked_range<size_t>& range) {
+            [this, &bottom_contacts, &top_contacts, &intermediate_layers, &layer_storage, &interface_layers](const tbb::blocked_range<size_t>& range) {
                 // Index of the first top contact layer intersecting the current intermediate layer.
                 size_t idx_top_contact_first = size_t(-1);
                 // Index of the first bottom contact layer intersecting the current intermediate layer.
@@ -2279,7 +2373,7 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::generate_int
                         continue;
 
                     // Insert a new layer into top_interface_layers.
-                    MyLayer &layer_new = layer_allocate(layer_storage, layer_storage_mutex,
+                    MyLayer &layer_new = layer_allocate(layer_storage,
                         polygons_top_contact_projected.empty() ? sltBottomInterface : sltTopInterface);
                     layer_new.print_z    = intermediate_layer.print_z;
                     layer_new.bottom_z   = intermediate_layer.bottom_z;
@@ -139,10 +139,9 @@ public:
     	Polygons *overhang_polygons;
 	};
 
-	// Layers are allocated and owned by a deque. Once a layer is allocated, it is maintained
-	// up to the end of a generate() method. The layer storage may be replaced by an allocator class in the future, 
-	// which would allocate layers by multiple chunks.
-	typedef std::deque<MyLayer> 				MyLayerStorage;
+	// Layers are allocated and owned by a MyLayerStorage. Once a layer is allocated, it is maintained
+	// up to the end of a generate() method. The layers are allocated by chunks from pools local to the allocating threads.
+	class MyLayerStorage;
 	typedef std::vector<MyLayer*> 				MyLayersPtr;
 
 public:
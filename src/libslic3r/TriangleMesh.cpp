@@ -629,6 +629,17 @@ void TriangleMesh::require_shared_vertices()
     BOOST_LOG_TRIVIAL(trace) << "TriangleMeshSlicer::require_shared_vertices - end";
 }
 
+void TriangleMesh::weld_vertices(float tolerance, std::vector<stl_vertex> &vertices, std::vector<v_indices_struct> &indices) const
+{
+    // Allocate for the worst case of no vertex being shared, then trim.
+    vertices.assign(3 * size_t(this->stl.stats.number_of_facets), stl_vertex());
+    indices.assign(this->stl.stats.number_of_facets, v_indices_struct());
+    vertices.resize(stl_weld_vertices(&this->stl, tolerance, vertices.data(), indices.data()));
+    vertices.shrink_to_fit();
+    if (vertices.empty())
+        indices.clear();
+}
+
 void TriangleMeshSlicer::init(TriangleMesh *_mesh, throw_on_cancel_callback_type throw_on_cancel)
 {
     mesh = _mesh;
@@ -640,6 +651,30 @@ void TriangleMeshSlicer::init(TriangleMesh *_mesh, throw_on_cancel_callback_type
     for (int i = 0; i < this->mesh->stl.stats.shared_vertices; ++ i)
         this->v_scaled_shared[i] *= float(1. / SCALING_FACTOR);
 
+    // Sort the facets by their minimum z. Then the first slicing plane above a facet bottom only moves up
+    // while walking the sorted facets, and no binary search over the slicing planes is needed per facet.
+    {
+        const int num_facets = _mesh->stl.stats.number_of_facets;
+        std::vector<float> min_z(num_facets), max_z(num_facets);
+        for (int facet_idx = 0; facet_idx < num_facets; ++ facet_idx) {
+            const stl_facet &facet = _mesh->stl.facet_start[facet_idx];
+            min_z[facet_idx] = fminf(facet.vertex[0](2), fminf(facet.vertex[1](2), facet.vertex[2](2)));
+            max_z[facet_idx] = fmaxf(facet.vertex[0](2), fmaxf(facet.vertex[1](2), facet.vertex[2](2)));
+        }
+        this->facets_by_min_z.resize(num_facets);
+        for (int facet_idx = 0; facet_idx < num_facets; ++ facet_idx)
+            this->facets_by_min_z[facet_idx] = facet_idx;
+        std::sort(this->facets_by_min_z.begin(), this->facets_by_min_z.end(), 
+            [&min_z](const int i1, const int i2) { return min_z[i1] < min_z[i2] || (min_z[i1] == min_z[i2] && i1 < i2); });
+        this->facets_min_z.resize(num_facets);
+        this->facets_max_z.resize(num_facets);
+        for (int i = 0; i < num_facets; ++ i) {
+            this->facets_min_z[i] = min_z[this->facets_by_min_z[i]];
+            this->facets_max_z[i] = max_z[this->facets_by_min_z[i]];
+        }
+    }
+    throw_on_cancel();
+
     // Create a mapping from triangle edge into face.
     struct EdgeToFace {
         // Index of the 1st vertex of the triangle edge. vertex_low <= vertex_high.
@@ -747,20 +782,78 @@ void TriangleMeshSlicer::slice(const std::vector<float> &z, std::vector<Polygons
     */
     
     BOOST_LOG_TRIVIAL(debug) << "TriangleMeshSlicer::_slice_do";
+    // The facets are processed in chunks of facets_by_min_z, each chunk collecting its intersection lines into its own buffer.
+    // The lines are then counted per layer and copied into their final place (two pass count then fill),
+    // so no locking is needed. As the chunks are filled in in their order, the resulting lines of each layer
+    // are ordered by facets_by_min_z independently of the number of threads and of the task scheduling.
+    // Thanks to the sorting of the facets by their min_z, a chunk touches a narrow band of layers only.
+    struct SliceChunk {
+        LayerIntersectionLines  lines;
+        // Range of layers touched by this chunk, starting with layer_begin.
+        size_t                  layer_begin;
+        // Number of lines of this chunk per layer, later replaced by the position of the next line of this chunk in a layer.
+        std::vector<size_t>     layer_offsets;
+    };
+    const size_t num_facets       = this->facets_by_min_z.size();
+    const size_t facets_per_chunk = std::max<size_t>(0x01000, num_facets / 64);
+    std::vector<SliceChunk> chunks((num_facets + facets_per_chunk - 1) / facets_per_chunk);
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, chunks.size()),
+        [&chunks, &z, num_facets, facets_per_chunk, throw_on_cancel, this](const tbb::blocked_range<size_t>& range) {
+            for (size_t chunk_idx = range.begin(); chunk_idx < range.end(); ++ chunk_idx) {
+                throw_on_cancel();
+                SliceChunk &chunk = chunks[chunk_idx];
+                this->_slice_do(chunk_idx * facets_per_chunk, std::min(num_facets, (chunk_idx + 1) * facets_per_chunk), &chunk.lines, z);
+                if (! chunk.lines.empty()) {
+                    size_t layer_min = chunk.lines.front().layer_idx;
+                    size_t layer_max = layer_min;
+                    for (const LayerIntersectionLine &il : chunk.lines) {
+                        layer_min = std::min(layer_min, il.layer_idx);
+                        layer_max = std::max(layer_max, il.layer_idx);
+                    }
+                    chunk.layer_begin = layer_min;
+                    chunk.layer_offsets.assign(layer_max + 1 - layer_min, 0);
+                    for (const LayerIntersectionLine &il : chunk.lines)
+                        ++ chunk.layer_offsets[il.layer_idx - layer_min];
+                }
+            }
+        }
+    );
+    throw_on_cancel();
+
+    // Reserve space for the lines of the chunks in the layers.
     std::vector<IntersectionLines> lines(z.size());
     {
-        boost::mutex lines_mutex;
+        std::vector<size_t> layer_sizes(z.size(), 0);
+        for (SliceChunk &chunk : chunks)
+            for (size_t i = 0; i < chunk.layer_offsets.size(); ++ i) {
+                size_t &layer_size = layer_sizes[chunk.layer_begin + i];
+                size_t  num_lines  = chunk.layer_offsets[i];
+                chunk.layer_offsets[i] = layer_size;
+                layer_size += num_lines;
+            }
         tbb::parallel_for(
-            tbb::blocked_range<int>(0,this->mesh->stl.stats.number_of_facets),
-            [&lines, &lines_mutex, &z, throw_on_cancel, this](const tbb::blocked_range<int>& range) {
-                for (int facet_idx = range.begin(); facet_idx < range.end(); ++ facet_idx) {
-                    if ((facet_idx & 0x0ffff) == 0)
-                        throw_on_cancel();
-                    this->_slice_do(facet_idx, &lines, &lines_mutex, z);
-                }
+            tbb::blocked_range<size_t>(0, z.size()),
+            [&lines, &layer_sizes](const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx)
+                    lines[layer_idx].resize(layer_sizes[layer_idx]);
             }
         );
     }
+    // Fill in the lines. Each chunk writes into its own slots of the layers.
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, chunks.size()),
+        [&chunks, &lines](const tbb::blocked_range<size_t>& range) {
+            for (size_t chunk_idx = range.begin(); chunk_idx < range.end(); ++ chunk_idx) {
+                SliceChunk &chunk = chunks[chunk_idx];
+                for (const LayerIntersectionLine &il : chunk.lines)
+                    lines[il.layer_idx][chunk.layer_offsets[il.layer_idx - chunk.layer_begin] ++] = il.line;
+                // Release the memory early.
+                chunk.lines = LayerIntersectionLines();
+                chunk.layer_offsets = std::vector<size_t>();
+            }
+        }
+    );
     throw_on_cancel();
 
     // v_scaled_shared could be freed here
@@ -814,40 +907,44 @@ void TriangleMeshSlicer::slice(const std::vector<float> &z, std::vector<Polygons
 #endif
 }
 
-void TriangleMeshSlicer::_slice_do(size_t facet_idx, std::vector<IntersectionLines>* lines, boost::mutex* lines_mutex, 
-    const std::vector<float> &z) const
+void TriangleMeshSlicer::_slice_do(size_t facets_begin, size_t facets_end, LayerIntersectionLines* lines, const std::vector<float> &z) const
 {
-    const stl_facet &facet = this->mesh->stl.facet_start[facet_idx];
-    
-    // find facet extents
-    const float min_z = fminf(facet.vertex[0](2), fminf(facet.vertex[1](2), facet.vertex[2](2)));
-    const float max_z = fmaxf(facet.vertex[0](2), fmaxf(facet.vertex[1](2), facet.vertex[2](2)));
-    
-    #ifdef SLIC3R_TRIANGLEMESH_DEBUG
-    printf("\n==> FACET %d (%f,%f,%f - %f,%f,%f - %f,%f,%f):\n", facet_idx,
-        facet.vertex[0](0), facet.vertex[0](1), facet.vertex[0](2),
-        facet.vertex[1](0), facet.vertex[1](1), facet.vertex[1](2),
-        facet.vertex[2](0), facet.vertex[2](1), facet.vertex[2](2));
-    printf("z: min = %.2f, max = %.2f\n", min_z, max_z);
-    #endif /* SLIC3R_TRIANGLEMESH_DEBUG */
-    
-    // find layer extents
-    std::vector<float>::const_iterator min_layer, max_layer;
-    min_layer = std::lower_bound(z.begin(), z.end(), min_z); // first layer whose slice_z is >= min_z
-    max_layer = std::upper_bound(min_layer, z.end(), max_z); // first layer whose slice_z is > max_z
-    #ifdef SLIC3R_TRIANGLEMESH_DEBUG
-    printf("layers: min = %d, max = %d\n", (int)(min_layer - z.begin()), (int)(max_layer - z.begin()));
-    #endif /* SLIC3R_TRIANGLEMESH_DEBUG */
-    
-    for (std::vector<float>::const_iterator it = min_layer; it != max_layer; ++ it) {
-        std::vector<float>::size_type layer_idx = it - z.begin();
-        IntersectionLine il;
-        if (this->slice_facet(*it / SCALING_FACTOR, facet, facet_idx, min_z, max_z, &il) == TriangleMeshSlicer::Slicing) {
-            boost::lock_guard<boost::mutex> l(*lines_mutex);
-            if (il.edge_type == feHorizontal) {
-                // Ignore horizontal triangles. Any valid horizontal triangle must have a vertical triangle connected, otherwise the part has zero volume.
-            } else
-                (*lines)[layer_idx].emplace_back(il);
+    if (facets_begin == facets_end)
+        return;
+
+    // First layer whose slice_z is >= min_z of the lowest facet of this range.
+    // As the facets are sorted by min_z, min_layer is only moved up from here.
+    std::vector<float>::const_iterator min_layer = std::lower_bound(z.begin(), z.end(), this->facets_min_z[facets_begin]);
+    for (size_t i = facets_begin; i < facets_end; ++ i) {
+        // find facet extents
+        const float min_z = this->facets_min_z[i];
+        const float max_z = this->facets_max_z[i];
+        while (min_layer != z.end() && *min_layer < min_z)
+            ++ min_layer;
+        if (min_layer == z.end())
+            // This facet and all the following facets are above the last slicing plane.
+            break;
+        const int        facet_idx = this->facets_by_min_z[i];
+        const stl_facet &facet     = this->mesh->stl.facet_start[facet_idx];
+
+        #ifdef SLIC3R_TRIANGLEMESH_DEBUG
+        printf("\n==> FACET %d (%f,%f,%f - %f,%f,%f - %f,%f,%f):\n", facet_idx,
+            facet.vertex[0](0), facet.vertex[0](1), facet.vertex[0](2),
+            facet.vertex[1](0), facet.vertex[1](1), facet.vertex[1](2),
+            facet.vertex[2](0), facet.vertex[2](1), facet.vertex[2](2));
+        printf("z: min = %.2f, max = %.2f\n", min_z, max_z);
+        #endif /* SLIC3R_TRIANGLEMESH_DEBUG */
+
+        // Walk the layers whose slice_z is <= max_z.
+        for (std::vector<float>::const_iterator it = min_layer; it != z.end() && *it <= max_z; ++ it) {
+            LayerIntersectionLine il;
+            il.layer_idx = it - z.begin();
+            if (this->slice_facet(*it / SCALING_FACTOR, facet, facet_idx, min_z, max_z, &il.line) == TriangleMeshSlicer::Slicing) {
+                if (il.line.edge_type == feHorizontal) {
+                    // Ignore horizontal triangles. Any valid horizontal triangle must have a vertical triangle connected, otherwise the part has zero volume.
+                } else
+                    lines->emplace_back(il);
+            }
         }
     }
 }
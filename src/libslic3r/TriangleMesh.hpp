@@ -75,6 +75,10 @@ public:
     // Count disconnected triangle patches.
     size_t number_of_patches() const;
 
+    // Merge the facet vertices closer than tolerance into a list of unique vertices, see stl_weld_vertices().
+    // In contrast to the shared vertices, the mesh does not need to be repaired.
+    void weld_vertices(float tolerance, std::vector<stl_vertex> &vertices, std::vector<v_indices_struct> &indices) const;
+
     stl_file stl;
     bool repaired;
     
@@ -181,8 +185,24 @@ private:
     std::vector<int>         facets_edges;
     // Scaled copy of this->mesh->stl.v_shared
     std::vector<stl_vertex>  v_scaled_shared;
+    // Facet indices sorted by the minimum z of a facet, ties broken by the facet index.
+    std::vector<int>         facets_by_min_z;
+    // Minimum and maximum z of the facets, in the order of facets_by_min_z. Kept separately from the 50 bytes long
+    // stl_facet structures, so that finding the slicing planes of a facet walks over compact arrays only.
+    std::vector<float>       facets_min_z;
+    std::vector<float>       facets_max_z;
+
+    // Intersection line tagged with the index of the slicing plane it belongs to.
+    // Collected into per facet chunk buffers by slice() and distributed into per layer IntersectionLines afterwards,
+    // so that the parallel facet pass does not need to synchronize on a shared container.
+    struct LayerIntersectionLine {
+        size_t           layer_idx;
+        IntersectionLine line;
+    };
+    typedef std::vector<LayerIntersectionLine> LayerIntersectionLines;
 
-    void _slice_do(size_t facet_idx, std::vector<IntersectionLines>* lines, boost::mutex* lines_mutex, const std::vector<float> &z) const;
+    // Slice the facets facets_by_min_z[facets_begin, facets_end) with the planes z, append the intersection lines to lines.
+    void _slice_do(size_t facets_begin, size_t facets_end, LayerIntersectionLines* lines, const std::vector<float> &z) const;
     void make_loops(std::vector<IntersectionLine> &lines, Polygons* loops) const;
     void make_expolygons(const Polygons &loops, ExPolygons* slices) const;
     void make_expolygons_simple(std::vector<IntersectionLine> &lines, ExPolygons* slices) const;
@@ -1,4 +1,4 @@
-use Test::More tests => 81;
+use Test::More tests => 114;
 use strict;
 use warnings;
 
@@ -50,31 +50,47 @@ use Slic3r::Test;
     my $config = Slic3r::Config::new_from_defaults;
     $config->set('printer_notes', '  PRINTER_VENDOR_PRUSA3D  PRINTER_MODEL_MK2  ');
     $config->set('nozzle_diameter', [0.6,0.6,0.6,0.6]);
+    $config->set('first_layer_temperature', [210,215,220,225]);
     $parser->apply_config($config);
     $parser->set('foo' => 0);
     $parser->set('bar' => 2);
     $parser->set('num_extruders' => 4);
-    is $parser->process('[temperature_[foo]]'),
-        $config->temperature->[0],
-        "nested config options (legacy syntax)";
-    is $parser->process('{temperature[foo]}'),
-        $config->temperature->[0],
-        "array reference";
-    is $parser->process("test [ temperature_ [foo] ] \n hu"),
-        "test " . $config->temperature->[0] . " \n hu",
-        "whitespaces and newlines are maintained";
-    is $parser->process('{2*3}'),     '6',   'math: 2*3';
-    is $parser->process('{2*3/6}'),   '1',   'math: 2*3/6';
-    is $parser->process('{2*3/12}'),  '0',   'math: 2*3/12';
-    ok abs($parser->process('{2.*3/12}') - 0.5) < 1e-7, 'math: 2.*3/12';
-    is $parser->process('{2*(3-12)}'), '-18', 'math: 2*(3-12)';
-    is $parser->process('{2*foo*(3-12)}'), '0', 'math: 2*foo*(3-12)';
-    is $parser->process('{2*bar*(3-12)}'), '-36', 'math: 2*bar*(3-12)';
-    ok abs($parser->process('{2.5*bar*(3-12)}') - -45) < 1e-7, 'math: 2.5*bar*(3-12)';
-    is $parser->process('{min(12, 14)}'), '12', 'math: min(12, 14)';
-    is $parser->process('{max(12, 14)}'), '14', 'math: max(12, 14)';
-    is $parser->process('{min(13.4, -1238.1)}'), '-1238.1', 'math: min(13.4, -1238.1)';
-    is $parser->process('{max(13.4, -1238.1)}'), '13.4', 'math: max(13.4, -1238.1)';
+    # Templates made of text and simple variable references are evaluated from a compiled form,
+    # the results shall be the same as of the macro processor.
+    foreach my $compiled (1, 0) {
+        $parser->set_compile_templates($compiled);
+        my $path = $compiled ? 'compiled' : 'macro processor';
+        is $parser->process('[temperature_[foo]]'),
+            $config->temperature->[0],
+            "nested config options (legacy syntax) ($path)";
+        is $parser->process('{temperature[foo]}'),
+            $config->temperature->[0],
+            "array reference ($path)";
+        is $parser->process("test [ temperature_ [foo] ] \n hu"),
+            "test " . $config->temperature->[0] . " \n hu",
+            "whitespaces and newlines are maintained ($path)";
+        is $parser->process('{2*3}'),     '6',   "math: 2*3 ($path)";
+        is $parser->process('{2*3/6}'),   '1',   "math: 2*3/6 ($path)";
+        is $parser->process('{2*3/12}'),  '0',   "math: 2*3/12 ($path)";
+        ok abs($parser->process('{2.*3/12}') - 0.5) < 1e-7, "math: 2.*3/12 ($path)";
+        is $parser->process('{2*(3-12)}'), '-18', "math: 2*(3-12) ($path)";
+        is $parser->process('{2*foo*(3-12)}'), '0', "math: 2*foo*(3-12) ($path)";
+        is $parser->process('{2*bar*(3-12)}'), '-36', "math: 2*bar*(3-12) ($path)";
+        ok abs($parser->process('{2.5*bar*(3-12)}') - -45) < 1e-7, "math: 2.5*bar*(3-12) ($path)";
+        is $parser->process('{min(12, 14)}'), '12', "math: min(12, 14) ($path)";
+        is $parser->process('{max(12, 14)}'), '14', "math: max(12, 14) ($path)";
+        is $parser->process('{min(13.4, -1238.1)}'), '-1238.1', "math: min(13.4, -1238.1) ($path)";
+        is $parser->process('{max(13.4, -1238.1)}'), '13.4', "math: max(13.4, -1238.1) ($path)";
+        is $parser->process("G28 ; home\nG1 Z5 F5000\n"), "G28 ; home\nG1 Z5 F5000\n", "plain text ($path)";
+        is $parser->process('M117 [bar]'), 'M117 2', "variable (legacy syntax) ($path)";
+        is $parser->process(';[layer_height]'), ';' . $config->layer_height, "config option (legacy syntax) ($path)";
+        is $parser->process('M104 S[first_layer_temperature_2]'), 'M104 S220', "vector indexed by a suffix (legacy syntax) ($path)";
+        is $parser->process('M104 S[first_layer_temperature]'), 'M104 S210', "vector indexed by the current extruder (legacy syntax) ($path)";
+        is $parser->process('{bar}'), '2', "variable reference ($path)";
+        is $parser->process('M104 S{first_layer_temperature[bar]}'), 'M104 S220', "array reference indexed by a variable ($path)";
+        is $parser->process('M104 S{first_layer_temperature[3]}'), 'M104 S225', "array reference indexed by a constant ($path)";
+        is $parser->process("  \n M104 S[bar]\n"), "M104 S2\n", "leading whitespaces are skipped ($path)";
+    }
 
     # Test the boolean expression parser.
     is $parser->evaluate_boolean_expression('12 == 12'), 1, 'boolean expression parser: 12 == 12';
@@ -3,8 +3,9 @@
 use strict;
 use warnings;
 
+use File::Temp qw(tempfile);
 use Slic3r::XS;
-use Test::More tests => 49;
+use Test::More tests => 53;
 
 is Slic3r::TriangleMesh::hello_world(), 'Hello world!',
     'hello world';
@@ -140,4 +141,28 @@ my $cube = {
     }
 }
 
+{
+    # ASCII STL files, whose last token is not followed by a new line.
+    my $facets = join '', map {
+        my @vertices = map $cube->{vertices}[$_], @$_;
+        "facet normal 0 0 0\n outer loop\n" . (join '', map "  vertex @$_\n", @vertices) . " endloop\nendfacet\n"
+    } @{$cube->{facets}};
+    foreach my $last_line ('endsolid cube', 'endfacet') {
+        my $stl = "solid cube\n" . $facets;
+        if ($last_line eq 'endfacet') {
+            chomp $stl;
+        } else {
+            $stl .= $last_line;
+        }
+        my ($fh, $filename) = tempfile(SUFFIX => '.stl', UNLINK => 1);
+        print $fh $stl;
+        close $fh;
+        my $m = Slic3r::TriangleMesh->new;
+        $m->ReadSTLFile($filename);
+        $m->repair;
+        is $m->facets_count, 12, "ASCII STL ending with $last_line without a new line is read completely";
+        ok abs($m->stats->{volume} - 20*20*20) < 1E-2, "ASCII STL ending with $last_line without a new line has the right volume";
+    }
+}
+
 __END__
@@ -9,7 +9,7 @@ BEGIN {
 }
 
 use Slic3r::XS;
-use Test::More tests => 20;
+use Test::More tests => 25;
 
 my $square = Slic3r::Polygon->new(  # ccw
     [100, 100],
@@ -89,4 +89,49 @@ my $expolygon = Slic3r::ExPolygon->new($square, $hole_in_square);
     ok $path->is_valid(), 'return path is valid';
 }
 
+{
+    # find_closest_node() with and without the grid index shall return the node Point::nearest_point_index() returns.
+    my $check = sub {
+        my ($nodes, $points) = @_;
+        return scalar grep {
+            my $expected = $_->nearest_point_index($nodes);
+            Slic3r::MotionPlanner::find_closest_node($nodes, $_, 0) != $expected
+                || Slic3r::MotionPlanner::find_closest_node($nodes, $_, 1) != $expected
+        } @$points;
+    };
+    srand 1;
+    my @nodes = map Slic3r::Point->new(int(rand(1000000)), int(rand(1000000))), 1..500;
+    my @points = ((map $_->clone, @nodes),
+        map Slic3r::Point->new(int(rand(1400000)) - 200000, int(rand(1400000)) - 200000), 1..300);
+    is $check->(\@nodes, \@points), 0, 'find_closest_node matches nearest_point_index on random nodes';
+    
+    # Each node of a regular lattice three times, points on the nodes and in the middle of the lattice cells.
+    my @lattice = map { my $i = $_; map Slic3r::Point->new($i * 1000, $_ * 1000), 0..9 } 0..9;
+    @nodes = (@lattice, map($_->clone, @lattice), map($_->clone, @lattice));
+    @points = ((map $_->clone, @lattice), map Slic3r::Point->new($_->x + 500, $_->y + 500), @lattice);
+    is $check->(\@nodes, \@points), 0, 'find_closest_node matches nearest_point_index on coincident nodes';
+}
+
+{
+    my $from = Slic3r::Point->new(120, 120);
+    my $to = Slic3r::Point->new(180,180);
+    $_->scale(1/0.000001) for $from, $to;
+    
+    my $mp1 = Slic3r::MotionPlanner->new([ $expolygon ]);
+    my $path1 = $mp1->shortest_path($from, $to);
+    
+    # The same island on the next layer.
+    my $mp2 = Slic3r::MotionPlanner->new_from_previous([ $expolygon->clone ], $mp1);
+    ok $mp2->shares_graph_with($mp1, 0), 'graph of an identical island is shared with the previous layer';
+    my $path2 = $mp2->shortest_path($from, $to);
+    is_deeply $path2->pp, $path1->pp, 'shared graph yields the same path';
+    
+    # A shifted island on the next layer.
+    my $expolygon2 = $expolygon->clone;
+    $expolygon2->translate(1/0.000001, 0);
+    my $mp3 = Slic3r::MotionPlanner->new_from_previous([ $expolygon2 ], $mp1);
+    $mp3->shortest_path($from, $to);
+    ok !$mp3->shares_graph_with($mp1, 0), 'graph of a changed island is not shared';
+}
+
 __END__